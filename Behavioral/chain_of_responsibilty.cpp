@@ -2,21 +2,69 @@
 
 /*
 --- Problem Statement ---
-Suppose we have to handle authentication requests with a chain of handlers. 
-Depending on the type of authentication request, the appropriate handler in the 
-chain handles it, or it is passed along the chain until a handler can process it 
+Suppose we have to handle authentication requests with a chain of handlers.
+Depending on the type of authentication request, the appropriate handler in the
+chain handles it, or it is passed along the chain until a handler can process it
 or until the end of the chain is reached.
+
+--- Compiled chain ---
+Walking the chain costs a virtual call and a string comparison per handler, so
+a request for the last of n methods does n comparisons. Each handler also
+lists the request types it accepts, and a CompiledAuthenticationChain turns the
+chain into a hash table from request type to the first handler that accepts
+it. Dispatch then takes one hash lookup and gives the same result as walking
+the chain. The compiled chain is a snapshot, so recompile it when the chain
+changes.
+
+--- Async chain ---
+When handlers do slow lookups, an AsyncAuthenticationChain runs every handler
+as a pipeline stage on a thread pool. Requests arrive in batches. Each stage
+authenticates the part of a batch it accepts with one authenticateBatch()
+call, then forwards the remainder to the next stage. A stage processes one
+batch at a time, so handlers need not be thread-safe, while different stages
+run at the same time. The first handler to accept a request still handles it.
+If authenticateBatch() throws, that part of the batch is reported as failed
+and the remainder still moves on to the next stage.
 */
 
 #include <iostream>
 #include <string>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 // Handler Interface
 class AuthenticationHandler {
 public:
     virtual void setNextHandler(AuthenticationHandler* handler) = 0;
     virtual void handleRequest(const std::string& request) = 0;
+
+    // What a compiled chain needs: the accepted request types, the work done
+    // for one of them, and the next link
+    virtual std::vector<std::string> acceptedRequests() const = 0;
+    virtual void authenticate(const std::string& request) = 0;
+    virtual AuthenticationHandler* getNextHandler() const = 0;
+
+    // Handles several accepted requests at once; override when a batch is
+    // cheaper than the same requests one by one
+    virtual void authenticateBatch(const std::vector<std::string>& requests) {
+        for (const std::string& request : requests) authenticate(request);
+    }
+
     virtual ~AuthenticationHandler() = default;
 };
 
@@ -32,13 +80,25 @@ public:
 
     void handleRequest(const std::string& request) override {
         if (request == "username_password") {
-            std::cout << "Authenticated using username and password." << std::endl;
+            authenticate(request);
         } else if (nextHandler) {
             nextHandler->handleRequest(request);
         } else {
             std::cout << "Invalid authentication method." << std::endl;
         }
     }
+
+    std::vector<std::string> acceptedRequests() const override {
+        return {"username_password"};
+    }
+
+    void authenticate(const std::string& /*request*/) override {
+        std::cout << "Authenticated using username and password." << std::endl;
+    }
+
+    AuthenticationHandler* getNextHandler() const override {
+        return nextHandler;
+    }
 };
 
 class OAuthHandler : public AuthenticationHandler {
@@ -52,13 +112,286 @@ public:
 
     void handleRequest(const std::string& request) override {
         if (request == "oauth_token") {
-            std::cout << "Authenticated using OAuth token." << std::endl;
+            authenticate(request);
         } else if (nextHandler) {
             nextHandler->handleRequest(request);
         } else {
             std::cout << "Invalid authentication method." << std::endl;
         }
     }
+
+    std::vector<std::string> acceptedRequests() const override {
+        return {"oauth_token"};
+    }
+
+    void authenticate(const std::string& /*request*/) override {
+        std::cout << "Authenticated using OAuth token." << std::endl;
+    }
+
+    AuthenticationHandler* getNextHandler() const override {
+        return nextHandler;
+    }
+};
+
+// Compiled chain
+// Request type -> first handler in chain order that accepts it. Handlers are
+// borrowed and must outlive the compiled chain.
+class CompiledAuthenticationChain {
+private:
+    std::unordered_map<std::string, AuthenticationHandler*> table;
+
+public:
+    explicit CompiledAuthenticationChain(AuthenticationHandler* head) {
+        for (AuthenticationHandler* handler = head; handler; handler = handler->getNextHandler()) {
+            for (const std::string& request : handler->acceptedRequests()) {
+                table.emplace(request, handler);   // keeps the earlier handler on duplicates
+            }
+        }
+    }
+
+    // Same outcome as head->handleRequest(request)
+    void handleRequest(const std::string& request) {
+        AuthenticationHandler* handler = findHandler(request);
+        if (handler) {
+            handler->authenticate(request);
+        } else {
+            std::cout << "Invalid authentication method." << std::endl;
+        }
+    }
+
+    AuthenticationHandler* findHandler(const std::string& request) const {
+        auto it = table.find(request);
+        return it == table.end() ? nullptr : it->second;
+    }
+
+    std::size_t size() const { return table.size(); }
+};
+
+// Thread pool
+class ThreadPool {
+private:
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable available;
+    bool stopping = false;
+
+    void workerLoop() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                available.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    explicit ThreadPool(std::size_t workers) {
+        for (std::size_t i = 0; i < std::max<std::size_t>(workers, 1); ++i) {
+            threads.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    // Runs the queued tasks, then joins
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        available.notify_all();
+        for (auto& thread : threads) thread.join();
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        available.notify_one();
+    }
+};
+
+// Async chain
+// One stage per handler, in chain order. Handlers are borrowed and must outlive
+// the chain. submit() blocks while maxInFlight batches are still in the pipeline.
+class AsyncAuthenticationChain {
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    struct Batch {
+        std::vector<std::string> requests;
+        std::vector<Clock::time_point> submitted;   // parallel to requests
+    };
+
+    struct Stage {
+        AuthenticationHandler* handler;
+        std::unordered_set<std::string> accepted;
+        std::mutex mutex;
+        std::deque<Batch> pending;
+        bool scheduled = false;
+
+        // Only touched by the task draining this stage
+        std::vector<double> latencies;   // microseconds, submit to completion
+        std::uint64_t rejected = 0;
+        std::uint64_t failed = 0;        // requests whose authenticateBatch() threw
+    };
+
+    std::vector<std::unique_ptr<Stage>> stages;
+    std::size_t maxInFlight;
+    std::size_t inFlight = 0;
+    std::mutex flightMutex;
+    std::condition_variable flightChanged;
+    ThreadPool pool;   // last, so it is joined before the stages go away
+
+    void enqueue(std::size_t index, Batch batch) {
+        Stage& stage = *stages[index];
+        bool schedule;
+        {
+            std::lock_guard<std::mutex> lock(stage.mutex);
+            stage.pending.push_back(std::move(batch));
+            schedule = !stage.scheduled;
+            stage.scheduled = true;
+        }
+        if (schedule) pool.submit([this, index] { drain(index); });
+    }
+
+    void drain(std::size_t index) {
+        Stage& stage = *stages[index];
+        for (;;) {
+            Batch batch;
+            {
+                std::lock_guard<std::mutex> lock(stage.mutex);
+                if (stage.pending.empty()) {
+                    stage.scheduled = false;
+                    return;
+                }
+                batch = std::move(stage.pending.front());
+                stage.pending.pop_front();
+            }
+            process(index, std::move(batch));
+        }
+    }
+
+    void process(std::size_t index, Batch batch) {
+        Stage& stage = *stages[index];
+        Batch accepted, remainder;
+        for (std::size_t i = 0; i < batch.requests.size(); ++i) {
+            Batch& target = stage.accepted.count(batch.requests[i]) ? accepted : remainder;
+            target.requests.push_back(std::move(batch.requests[i]));
+            target.submitted.push_back(batch.submitted[i]);
+        }
+
+        if (!accepted.requests.empty()) {
+            try {
+                stage.handler->authenticateBatch(accepted.requests);
+                complete(stage, accepted);
+            } catch (const std::exception& error) {
+                fail(stage, accepted, error.what());
+            } catch (...) {
+                fail(stage, accepted, "unknown error");
+            }
+        }
+
+        if (remainder.requests.empty()) {
+            finishBatch();
+        } else if (index + 1 < stages.size()) {
+            enqueue(index + 1, std::move(remainder));
+        } else {
+            for (std::size_t i = 0; i < remainder.requests.size(); ++i) {
+                std::cout << "Invalid authentication method." << std::endl;
+            }
+            stage.rejected += remainder.requests.size();
+            complete(stage, remainder);
+            finishBatch();
+        }
+    }
+
+    static void complete(Stage& stage, const Batch& batch) {
+        auto now = Clock::now();
+        for (const auto& submitted : batch.submitted) {
+            stage.latencies.push_back(std::chrono::duration<double, std::micro>(now - submitted).count());
+        }
+    }
+
+    static void fail(Stage& stage, const Batch& batch, const char* what) {
+        std::cerr << "Authentication failed for " << batch.requests.size() << " requests: " << what << std::endl;
+        stage.failed += batch.requests.size();
+    }
+
+    void finishBatch() {
+        {
+            std::lock_guard<std::mutex> lock(flightMutex);
+            --inFlight;
+        }
+        flightChanged.notify_all();
+    }
+
+public:
+    AsyncAuthenticationChain(AuthenticationHandler* head, std::size_t workers, std::size_t maxInFlight = 64)
+        : maxInFlight(std::max<std::size_t>(maxInFlight, 1)), pool(workers) {
+        for (AuthenticationHandler* handler = head; handler; handler = handler->getNextHandler()) {
+            auto stage = std::make_unique<Stage>();
+            stage->handler = handler;
+            for (const std::string& request : handler->acceptedRequests()) {
+                // An earlier stage already takes this type, just as in the chain
+                bool taken = std::any_of(stages.begin(), stages.end(),
+                                         [&request](const auto& earlier) { return earlier->accepted.count(request) > 0; });
+                if (!taken) stage->accepted.insert(request);
+            }
+            stages.push_back(std::move(stage));
+        }
+    }
+
+    ~AsyncAuthenticationChain() { waitIdle(); }
+
+    void submit(std::vector<std::string> requests) {
+        if (requests.empty()) return;
+        if (stages.empty()) {
+            for (std::size_t i = 0; i < requests.size(); ++i) {
+                std::cout << "Invalid authentication method." << std::endl;
+            }
+            return;
+        }
+        {
+            std::unique_lock<std::mutex> lock(flightMutex);
+            flightChanged.wait(lock, [this] { return inFlight < maxInFlight; });
+            ++inFlight;
+        }
+        Batch batch;
+        batch.submitted.assign(requests.size(), Clock::now());
+        batch.requests = std::move(requests);
+        enqueue(0, std::move(batch));
+    }
+
+    // Waits until every submitted request has been handled or rejected
+    void waitIdle() {
+        std::unique_lock<std::mutex> lock(flightMutex);
+        flightChanged.wait(lock, [this] { return inFlight == 0; });
+    }
+
+    // Call after waitIdle()
+    std::vector<double> latencies() const {
+        std::vector<double> all;
+        for (const auto& stage : stages) all.insert(all.end(), stage->latencies.begin(), stage->latencies.end());
+        return all;
+    }
+
+    std::uint64_t rejectedCount() const {
+        return stages.empty() ? 0 : stages.back()->rejected;
+    }
+
+    // Requests a handler threw on. Call after waitIdle().
+    std::uint64_t failedCount() const {
+        std::uint64_t failed = 0;
+        for (const auto& stage : stages) failed += stage->failed;
+        return failed;
+    }
 };
 
 void using_smart_pointers() {
@@ -74,7 +407,240 @@ void using_smart_pointers() {
     usernamePasswordHandler->handleRequest("invalid_method");
 }
 
-int main() {
+void using_compiled_chain() {
+    auto oauthHandler = std::make_unique<OAuthHandler>();
+    auto usernamePasswordHandler = std::make_unique<UsernamePasswordHandler>();
+    usernamePasswordHandler->setNextHandler(oauthHandler.get());
+
+    // Same requests, one lookup each
+    CompiledAuthenticationChain chain(usernamePasswordHandler.get());
+    chain.handleRequest("oauth_token");
+    chain.handleRequest("username_password");
+    chain.handleRequest("invalid_method");
+}
+
+void using_async_chain() {
+    auto oauthHandler = std::make_unique<OAuthHandler>();
+    auto usernamePasswordHandler = std::make_unique<UsernamePasswordHandler>();
+    usernamePasswordHandler->setNextHandler(oauthHandler.get());
+
+    // One batch; each stage takes its part and passes the rest on
+    AsyncAuthenticationChain chain(usernamePasswordHandler.get(), 2);
+    chain.submit({"oauth_token", "username_password", "invalid_method"});
+    chain.waitIdle();
+}
+
+// Benchmark
+// One handler per method; authenticating adds the handler's position so the
+// checksum shows which handler took each request.
+class CountingHandler : public AuthenticationHandler {
+private:
+    AuthenticationHandler* nextHandler = nullptr;
+    std::string method;
+    std::uint64_t position;
+    std::uint64_t& checksum;
+
+public:
+    CountingHandler(std::string method, std::uint64_t position, std::uint64_t& checksum)
+        : method(std::move(method)), position(position), checksum(checksum) {}
+
+    void setNextHandler(AuthenticationHandler* handler) override {
+        nextHandler = handler;
+    }
+
+    void handleRequest(const std::string& request) override {
+        if (request == method) {
+            authenticate(request);
+        } else if (nextHandler) {
+            nextHandler->handleRequest(request);
+        } else {
+            std::cout << "Invalid authentication method." << std::endl;
+        }
+    }
+
+    std::vector<std::string> acceptedRequests() const override {
+        return {method};
+    }
+
+    void authenticate(const std::string& /*request*/) override {
+        checksum += position;
+    }
+
+    AuthenticationHandler* getNextHandler() const override {
+        return nextHandler;
+    }
+};
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void runBenchmark(int requests) {
+    std::cout << "Benchmark: " << requests << " requests spread evenly over the chain\n";
+    for (int length : {1, 10, 100, 500}) {
+        std::uint64_t chainSum = 0;
+        std::uint64_t compiledSum = 0;
+        std::vector<std::unique_ptr<CountingHandler>> walked, compiled;
+        std::vector<std::string> methods;
+        for (int i = 0; i < length; ++i) {
+            methods.push_back("auth_method_" + std::to_string(i));
+            walked.push_back(std::make_unique<CountingHandler>(methods.back(), i + 1, chainSum));
+            compiled.push_back(std::make_unique<CountingHandler>(methods.back(), i + 1, compiledSum));
+            if (i > 0) {
+                walked[i - 1]->setNextHandler(walked[i].get());
+                compiled[i - 1]->setNextHandler(compiled[i].get());
+            }
+        }
+
+        // Same pseudo-random request sequence for both
+        std::vector<const std::string*> sequence(requests);
+        std::uint32_t state = 12345u;
+        for (auto& request : sequence) {
+            state = state * 1664525u + 1013904223u;
+            request = &methods[(state >> 8) % length];
+        }
+
+        auto start = Clock::now();
+        for (const std::string* request : sequence) walked.front()->handleRequest(*request);
+        double chainSeconds = secondsSince(start);
+
+        start = Clock::now();
+        CompiledAuthenticationChain chain(compiled.front().get());
+        double compileSeconds = secondsSince(start);
+        start = Clock::now();
+        for (const std::string* request : sequence) chain.handleRequest(*request);
+        double compiledSeconds = secondsSince(start);
+
+        std::cout << "  " << length << " handlers: chain " << chainSeconds / requests * 1e9 << " ns/request, compiled "
+                  << compiledSeconds / requests * 1e9 << " ns/request (built in " << compileSeconds * 1e6
+                  << " us), checksums " << chainSum << " / " << compiledSum << "\n";
+    }
+}
+
+// Credential store stand-in: every call pays a round trip, whatever its size
+class CredentialStore {
+private:
+    std::chrono::microseconds roundTrip;
+    std::atomic<std::uint64_t> calls{0};
+
+public:
+    explicit CredentialStore(std::chrono::microseconds roundTrip) : roundTrip(roundTrip) {}
+
+    void verify(std::size_t /*requests*/) {
+        ++calls;
+        std::this_thread::sleep_for(roundTrip);
+    }
+
+    std::uint64_t callCount() const { return calls; }
+};
+
+class CredentialStoreHandler : public CountingHandler {
+private:
+    CredentialStore& store;
+
+public:
+    CredentialStoreHandler(std::string method, std::uint64_t position, std::uint64_t& checksum, CredentialStore& store)
+        : CountingHandler(std::move(method), position, checksum), store(store) {}
+
+    void authenticate(const std::string& request) override {
+        store.verify(1);
+        CountingHandler::authenticate(request);
+    }
+
+    void authenticateBatch(const std::vector<std::string>& requests) override {
+        store.verify(requests.size());
+        for (const std::string& request : requests) CountingHandler::authenticate(request);
+    }
+};
+
+std::string latencySummary(std::vector<double> latencies) {
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+        return latencies[std::min(latencies.size() - 1, static_cast<std::size_t>(p * latencies.size()))];
+    };
+    std::ostringstream out;
+    out << "p50 " << percentile(0.50) << " us, p99 " << percentile(0.99) << " us";
+    return out.str();
+}
+
+// Four handlers that each call the store, one request at a time vs in batches
+void runPipelineBenchmark(int requests) {
+    const std::chrono::microseconds roundTrip(200);
+    const int stages = 4;
+    std::cout << "Pipeline benchmark: " << stages << " handlers, " << roundTrip.count()
+              << " us store round trip\n";
+
+    // Stages run on different threads, so every handler sums into its own slot
+    auto buildChain = [&](std::vector<std::uint64_t>& checksums, CredentialStore& store) {
+        std::vector<std::unique_ptr<CountingHandler>> chain;
+        for (int i = 0; i < stages; ++i) {
+            chain.push_back(std::make_unique<CredentialStoreHandler>("auth_method_" + std::to_string(i), i + 1,
+                                                                     checksums[i], store));
+            if (i > 0) chain[i - 1]->setNextHandler(chain[i].get());
+        }
+        return chain;
+    };
+    auto requestAt = [stages](int i) {
+        std::uint32_t state = static_cast<std::uint32_t>(i) * 2654435761u;
+        return "auth_method_" + std::to_string((state >> 8) % stages);
+    };
+
+    // Synchronous: one store call per request; fewer requests or it takes forever
+    {
+        int count = std::max(requests / 50, 1);
+        std::vector<std::uint64_t> checksums(stages);
+        CredentialStore store(roundTrip);
+        auto chain = buildChain(checksums, store);
+        std::vector<double> latencies;
+        auto start = Clock::now();
+        for (int i = 0; i < count; ++i) {
+            std::string request = requestAt(i);
+            auto begin = Clock::now();
+            chain.front()->handleRequest(request);
+            latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - begin).count());
+        }
+        double seconds = secondsSince(start);
+        std::cout << "  synchronous, " << count << " requests: " << count / seconds << " req/s, "
+                  << latencySummary(latencies) << ", checksum "
+                  << std::accumulate(checksums.begin(), checksums.end(), std::uint64_t{0}) << "\n";
+    }
+
+    for (std::size_t batchSize : {16, 64, 256}) {
+        std::vector<std::uint64_t> checksums(stages);
+        CredentialStore store(roundTrip);
+        auto chain = buildChain(checksums, store);
+        double seconds;
+        std::vector<double> latencies;
+        {
+            AsyncAuthenticationChain async(chain.front().get(), stages, 16);
+            auto start = Clock::now();
+            for (int i = 0; i < requests;) {
+                std::vector<std::string> batch;
+                for (std::size_t j = 0; j < batchSize && i < requests; ++j, ++i) batch.push_back(requestAt(i));
+                async.submit(std::move(batch));
+            }
+            async.waitIdle();
+            seconds = secondsSince(start);
+            latencies = async.latencies();
+        }
+        std::cout << "  async, batches of " << batchSize << ": " << requests / seconds << " req/s, "
+                  << latencySummary(latencies) << ", " << store.callCount() << " store calls, checksum "
+                  << std::accumulate(checksums.begin(), checksums.end(), std::uint64_t{0}) << "\n";
+    }
+}
+
+// Usage: chain_of_responsibilty [--bench [requests]]
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        runBenchmark(argc > 2 ? std::atoi(argv[2]) : 1000000);
+        runPipelineBenchmark(argc > 2 ? std::atoi(argv[2]) / 5 : 200000);
+        return 0;
+    }
+
     using_smart_pointers();
+    using_compiled_chain();
+    using_async_chain();
     return 0;
-}
\ No newline at end of file
+}
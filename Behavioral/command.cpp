@@ -1,12 +1,45 @@
 // command.cpp
 
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 /*
---- Problem statement --- 
+--- Problem statement ---
 Design a system that demonstrates the use of the Command Pattern to decouple the
-sender and receiver of a request. The system should consist of several key 
+sender and receiver of a request. The system should consist of several key
 components: Command, Concrete Command, Receiver, and Invoker.
+
+--- Concurrent invoker ---
+Many threads submit commands at once and a pool of workers runs them. Commands
+go through lock-free bounded queues (one shared queue plus one lane per
+worker). A command that names an ordering key, such as its receiver, always
+goes to the same lane, so commands for one receiver run in the order they were
+submitted. Submitting can return a future that completes when the command
+has run.
+
+--- Inline commands ---
+InplaceCommand stores a command object (a ConcreteCommand, or any callable
+such as a lambda bound to a receiver) inside a fixed-size buffer instead of on
+the heap. It is move-only, and a type that does not fit is rejected at compile
+time. InplaceInvoker keeps them by value in one contiguous array.
 */
 
 // Receiver
@@ -21,8 +54,14 @@ public:
 // Command interface
 class Command {
 public:
+    virtual ~Command() = default;
+
     // The execute method is declared in the Command interface.
     virtual void execute() = 0;
+
+    // Commands with the same key run in submission order on a ConcurrentInvoker.
+    // nullptr means the command may run anywhere.
+    virtual const void* orderingKey() const { return nullptr; }
 };
 
 // Concrete Command
@@ -37,7 +76,12 @@ public:
 
     // The execute method calls the action on the Receiver.
     void execute() {
-        receiver.performAction(); 
+        receiver.performAction();
+    }
+
+    // Commands on the same receiver keep their order.
+    const void* orderingKey() const override {
+        return &receiver;
     }
 };
 
@@ -49,16 +93,502 @@ private:
 public:
     // The setCommand method allows setting the command to be executed.
     void setCommand(Command* cmd) {
-        command = cmd; 
+        command = cmd;
     }
 
     // The executeCommand method triggers the execution of the command.
-    void executeCommand() { 
-        command->execute(); 
+    void executeCommand() {
+        command->execute();
+    }
+};
+
+// Inline command
+// Holds any command object of up to Capacity bytes without allocating. The
+// object is either callable or has an execute() method, like ConcreteCommand.
+template <std::size_t Capacity = 32>
+class InplaceCommand {
+private:
+    struct Ops {
+        void (*execute)(void* self);
+        void (*moveTo)(void* self, void* destination);   // move-constructs, then destroys self
+        void (*destroy)(void* self);
+    };
+
+    template <typename T>
+    static void executeImpl(void* self) {
+        T& object = *static_cast<T*>(self);
+        if constexpr (std::is_invocable_v<T&>) object();
+        else object.execute();
+    }
+
+    template <typename T>
+    static void moveToImpl(void* self, void* destination) {
+        new (destination) T(std::move(*static_cast<T*>(self)));
+        static_cast<T*>(self)->~T();
+    }
+
+    template <typename T>
+    static void destroyImpl(void* self) {
+        static_cast<T*>(self)->~T();
+    }
+
+    template <typename T>
+    static const Ops* opsFor() {
+        static constexpr Ops ops{&executeImpl<T>, &moveToImpl<T>, &destroyImpl<T>};
+        return &ops;
+    }
+
+    alignas(std::max_align_t) unsigned char storage[Capacity];
+    const Ops* ops = nullptr;
+
+    void reset() {
+        if (ops) ops->destroy(storage);
+        ops = nullptr;
+    }
+
+public:
+    InplaceCommand() = default;
+
+    template <typename T, typename Stored = std::decay_t<T>,
+              typename = std::enable_if_t<!std::is_same<Stored, InplaceCommand>::value>>
+    InplaceCommand(T&& command) {
+        static_assert(sizeof(Stored) <= Capacity, "command does not fit in InplaceCommand");
+        static_assert(alignof(Stored) <= alignof(std::max_align_t), "command is over-aligned");
+        static_assert(std::is_nothrow_move_constructible<Stored>::value, "command must be nothrow movable");
+        new (storage) Stored(std::forward<T>(command));
+        ops = opsFor<Stored>();
+    }
+
+    InplaceCommand(InplaceCommand&& other) noexcept : ops(other.ops) {
+        if (ops) ops->moveTo(other.storage, storage);
+        other.ops = nullptr;
+    }
+
+    InplaceCommand& operator=(InplaceCommand&& other) noexcept {
+        if (this != &other) {
+            reset();
+            ops = other.ops;
+            if (ops) ops->moveTo(other.storage, storage);
+            other.ops = nullptr;
+        }
+        return *this;
+    }
+
+    InplaceCommand(const InplaceCommand&) = delete;
+    InplaceCommand& operator=(const InplaceCommand&) = delete;
+
+    ~InplaceCommand() { reset(); }
+
+    explicit operator bool() const { return ops != nullptr; }
+
+    void execute() { ops->execute(storage); }
+};
+
+// Binds a receiver and one of its member functions, like ConcreteCommand does
+template <typename R>
+auto bindAction(R& receiver, void (R::*action)()) {
+    return [&receiver, action] { (receiver.*action)(); };
+}
+
+// Invoker that keeps its commands inline in one array
+template <std::size_t Capacity = 32>
+class InplaceInvoker {
+private:
+    std::vector<InplaceCommand<Capacity>> commands;
+
+public:
+    void reserve(std::size_t count) { commands.reserve(count); }
+
+    template <typename T>
+    void addCommand(T&& command) {
+        commands.emplace_back(std::forward<T>(command));
+    }
+
+    void executeCommands() {
+        for (auto& command : commands) command.execute();
+    }
+
+    void clear() { commands.clear(); }
+    std::size_t size() const { return commands.size(); }
+};
+
+// Bounded multi-producer/multi-consumer queue (Dmitry Vyukov's design).
+// Every cell carries a sequence number that tells producers and consumers
+// whose turn it is, so push and pop are a single CAS on the shared position.
+template <typename T>
+class MpmcQueue {
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    std::size_t mask;
+    alignas(64) std::atomic<std::size_t> enqueuePos{0};
+    alignas(64) std::atomic<std::size_t> dequeuePos{0};
+
+public:
+    explicit MpmcQueue(std::size_t capacity) : cells(new Cell[capacity]), mask(capacity - 1) {
+        if (capacity < 2 || (capacity & mask) != 0) {
+            std::cerr << "MpmcQueue capacity must be a power of two\n";
+            std::abort();
+        }
+        for (std::size_t i = 0; i < capacity; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool tryPush(T& value) {
+        std::size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & mask];
+            std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            std::intptr_t diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.data = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;   // full
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& out) {
+        std::size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & mask];
+            std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            std::intptr_t diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(cell.data);
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;   // empty
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+// Concurrent Invoker
+// Commands are not owned: they must stay alive until they have run.
+class ConcurrentInvoker {
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    struct Job {
+        Command* command = nullptr;
+        std::unique_ptr<std::promise<void>> done;   // only set by submit()
+        Clock::time_point enqueued;
+    };
+
+    static constexpr std::size_t kQueueCapacity = 1 << 16;
+    static constexpr int kSpinsBeforeSleep = 256;
+
+    MpmcQueue<Job> shared{kQueueCapacity};
+    std::vector<std::unique_ptr<MpmcQueue<Job>>> lanes;
+    std::vector<std::thread> workers;
+    std::vector<std::vector<double>> latencies;   // per worker, microseconds
+    std::vector<std::uint64_t> laneRuns;          // per worker, keyed commands run
+    bool recordLatency;
+
+    std::atomic<std::size_t> queued{0};     // waiting in a queue
+    std::atomic<std::size_t> inFlight{0};   // submitted and not finished yet
+    std::atomic<int> sleepers{0};
+    std::atomic<bool> stopping{false};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+
+    void enqueue(MpmcQueue<Job>& queue, Job job) {
+        job.enqueued = Clock::now();
+        ++inFlight;
+        ++queued;
+        while (!queue.tryPush(job)) {
+            std::this_thread::yield();   // queue full, wait for the workers
+        }
+        if (sleepers.load() > 0) {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            wake.notify_all();
+        }
+    }
+
+    // std::hash of a pointer is the address itself, and receivers are 16-byte
+    // aligned, so mix the bits before picking a lane
+    MpmcQueue<Job>& queueFor(const Command* command) {
+        const void* key = command->orderingKey();
+        if (!key) return shared;
+        std::uint64_t hash = (static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(key)) >> 4)
+                             * 0x9E3779B97F4A7C15ull;
+        return *lanes[(hash >> 32) % lanes.size()];
+    }
+
+    void run(std::size_t self) {
+        MpmcQueue<Job>& lane = *lanes[self];
+        Job job;
+        int idle = 0;
+        while (true) {
+            // The worker's own lane first, so keyed commands are never starved
+            bool keyed = lane.tryPop(job);
+            if (keyed || shared.tryPop(job)) {
+                --queued;
+                laneRuns[self] += keyed;
+                idle = 0;
+                if (recordLatency) {
+                    latencies[self].push_back(
+                        std::chrono::duration<double, std::micro>(Clock::now() - job.enqueued).count());
+                }
+                // A throwing command fails its own future; the lane keeps going
+                try {
+                    job.command->execute();
+                    if (job.done) job.done->set_value();
+                } catch (...) {
+                    if (job.done) job.done->set_exception(std::current_exception());
+                }
+                job.done.reset();
+                --inFlight;
+                continue;
+            }
+            if (stopping && queued == 0) return;
+            if (++idle < kSpinsBeforeSleep) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            ++sleepers;
+            wake.wait_for(lock, std::chrono::milliseconds(1), [this] { return queued > 0 || stopping; });
+            --sleepers;
+            idle = 0;
+        }
+    }
+
+public:
+    explicit ConcurrentInvoker(std::size_t workerCount = std::thread::hardware_concurrency(),
+                               bool recordLatency = false)
+        : recordLatency(recordLatency) {
+        workerCount = std::max<std::size_t>(workerCount, 1);
+        latencies.resize(workerCount);
+        laneRuns.resize(workerCount);
+        for (std::size_t i = 0; i < workerCount; ++i) {
+            lanes.push_back(std::make_unique<MpmcQueue<Job>>(kQueueCapacity));
+        }
+        for (std::size_t i = 0; i < workerCount; ++i) {
+            workers.emplace_back(&ConcurrentInvoker::run, this, i);
+        }
+    }
+
+    // Runs everything already submitted, then stops the workers
+    ~ConcurrentInvoker() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    ConcurrentInvoker(const ConcurrentInvoker&) = delete;
+    ConcurrentInvoker& operator=(const ConcurrentInvoker&) = delete;
+
+    // Fire and forget: an exception thrown by the command is dropped
+    void post(Command* command) {
+        Job job;
+        job.command = command;
+        enqueue(queueFor(command), std::move(job));
+    }
+
+    // The future becomes ready once the command has run, and rethrows from
+    // get() whatever the command threw
+    std::future<void> submit(Command* command) {
+        Job job;
+        job.command = command;
+        job.done = std::make_unique<std::promise<void>>();
+        std::future<void> future = job.done->get_future();
+        enqueue(queueFor(command), std::move(job));
+        return future;
+    }
+
+    // Blocks until every command submitted so far has run
+    void waitIdle() const {
+        while (inFlight > 0) std::this_thread::yield();
+    }
+
+    // Queueing latency of every command run so far, when recording is enabled.
+    // Call waitIdle() first.
+    std::vector<double> queueLatencies() const {
+        std::vector<double> all;
+        for (const auto& perWorker : latencies) all.insert(all.end(), perWorker.begin(), perWorker.end());
+        return all;
+    }
+
+    // Keyed commands each lane has run. Call waitIdle() first.
+    const std::vector<std::uint64_t>& laneCommandCounts() const { return laneRuns; }
+};
+
+// Benchmark
+// Each receiver checks that its commands arrive in the order they were submitted.
+class CountingReceiver {
+public:
+    std::uint64_t expected = 0;
+    std::uint64_t outOfOrder = 0;
+
+    void apply(std::uint64_t sequence) {
+        if (sequence != expected) ++outOfOrder;
+        expected = sequence + 1;
+    }
+};
+
+class SequencedCommand : public Command {
+private:
+    CountingReceiver* receiver = nullptr;
+    std::uint64_t sequence = 0;
+
+public:
+    SequencedCommand() = default;
+    SequencedCommand(CountingReceiver& rec, std::uint64_t seq) : receiver(&rec), sequence(seq) {}
+
+    void execute() override {
+        receiver->apply(sequence);
+    }
+
+    const void* orderingKey() const override {
+        return receiver;
     }
 };
 
-int main() {
+std::string latencySummary(std::vector<double> latencies) {
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+        return latencies[std::min(latencies.size() - 1, static_cast<std::size_t>(p * latencies.size()))];
+    };
+    std::ostringstream out;
+    out << "p50 " << percentile(0.50) << " us, p99 " << percentile(0.99)
+        << " us, p99.9 " << percentile(0.999) << " us";
+    return out.str();
+}
+
+// Producers submit as fast as they can, so latency includes the backlog
+void runBenchmark(std::size_t workers, std::size_t producers, std::size_t perProducer) {
+    const std::size_t receiversPerProducer = 8;
+    std::vector<CountingReceiver> receivers(producers * receiversPerProducer);
+    std::vector<std::vector<SequencedCommand>> commands(producers);
+    for (std::size_t p = 0; p < producers; ++p) {
+        for (std::size_t i = 0; i < perProducer; ++i) {
+            std::size_t r = i % receiversPerProducer;
+            commands[p].emplace_back(receivers[p * receiversPerProducer + r], i / receiversPerProducer);
+        }
+    }
+
+    ConcurrentInvoker invoker(workers, true);
+    auto start = ConcurrentInvoker::Clock::now();
+    std::vector<std::thread> threads;
+    for (std::size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&invoker, &commands, p] {
+            for (auto& command : commands[p]) invoker.post(&command);
+        });
+    }
+    for (auto& t : threads) t.join();
+    invoker.waitIdle();
+    double seconds = std::chrono::duration<double>(ConcurrentInvoker::Clock::now() - start).count();
+
+    std::uint64_t outOfOrder = 0;
+    for (const auto& r : receivers) outOfOrder += r.outOfOrder;
+
+    std::cout << "  workers " << workers << ", producers " << producers << ": "
+              << producers * perProducer / seconds / 1e6 << " M commands/s, queueing latency "
+              << latencySummary(invoker.queueLatencies()) << ", out of order " << outOfOrder << "\n";
+
+    const auto& lanes = invoker.laneCommandCounts();
+    auto [fewest, most] = std::minmax_element(lanes.begin(), lanes.end());
+    std::cout << "    lane spread: " << *fewest << " to " << *most << " commands per lane\n";
+}
+
+// One command at a time, waiting on its future: latency without a backlog
+void runLatencyProbe(std::size_t workers, std::size_t count) {
+    CountingReceiver receiver;
+    std::vector<SequencedCommand> commands;
+    for (std::size_t i = 0; i < count; ++i) commands.emplace_back(receiver, i);
+
+    ConcurrentInvoker invoker(workers, true);
+    for (auto& command : commands) invoker.submit(&command).wait();
+    invoker.waitIdle();
+    std::cout << "  unloaded, workers " << workers << ": queueing latency "
+              << latencySummary(invoker.queueLatencies()) << "\n";
+}
+
+// Create, run and destroy `count` commands, three ways
+void runInlineBenchmark(std::size_t count, int rounds) {
+    using Clock = std::chrono::steady_clock;
+    CountingReceiver receiver;
+    std::uint64_t sequence = 0;
+
+    auto report = [count, rounds](const char* name, Clock::time_point start) {
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << "  " << name << count * rounds / seconds / 1e6 << " M commands/s\n";
+    };
+
+    auto start = Clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        std::vector<std::unique_ptr<Command>> heap;
+        heap.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) heap.push_back(std::make_unique<SequencedCommand>(receiver, sequence++));
+        for (auto& command : heap) command->execute();
+    }
+    report("unique_ptr<Command>:         ", start);
+
+    start = Clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        std::vector<std::function<void()>> functions;
+        functions.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            functions.emplace_back([command = SequencedCommand(receiver, sequence++)]() mutable {
+                command.execute();
+            });
+        }
+        for (auto& function : functions) function();
+    }
+    report("std::function:               ", start);
+
+    start = Clock::now();
+    InplaceInvoker<> invoker;
+    for (int r = 0; r < rounds; ++r) {
+        invoker.clear();
+        invoker.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) invoker.addCommand(SequencedCommand(receiver, sequence++));
+        invoker.executeCommands();
+    }
+    report("InplaceInvoker (by value):   ", start);
+
+    if (receiver.outOfOrder != 0) std::cout << "  commands ran out of order\n";
+}
+
+// Usage: command [--bench [commands per producer]]
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        std::size_t perProducer = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 250000;
+        std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        std::cout << "Concurrent invoker benchmark (" << perProducer << " commands per producer)\n";
+        runBenchmark(1, 1, perProducer);
+        runBenchmark(cores, 1, perProducer);
+        runBenchmark(cores, 4, perProducer);
+        runBenchmark(2 * cores, 8, perProducer);
+        runBenchmark(8, 8, perProducer);   // enough lanes to show how keys spread
+        runLatencyProbe(cores, 20000);
+        std::cout << "Inline command benchmark (create + execute + destroy)\n";
+        runInlineBenchmark(1000000, 10);
+        return 0;
+    }
+
     // Create a Receiver instance.
     Receiver receiver;
 
@@ -74,5 +604,17 @@ int main() {
     // Execute the command.
     invoker.executeCommand();
 
+    // Run the same command from a pool of workers and wait for it
+    ConcurrentInvoker concurrentInvoker(2);
+    std::future<void> done = concurrentInvoker.submit(&command);
+    done.wait();
+    std::cout << "Concurrent invoker finished the command" << std::endl;
+
+    // Commands stored by value, no heap allocation per command
+    InplaceInvoker<> inplaceInvoker;
+    inplaceInvoker.addCommand(ConcreteCommand(receiver));
+    inplaceInvoker.addCommand(bindAction(receiver, &Receiver::performAction));
+    inplaceInvoker.executeCommands();
+
     return 0;
-}
\ No newline at end of file
+}
@@ -1,20 +1,510 @@
 // interpreter.cpp
 
+/*
+--- Problem statement ---
+Evaluate arithmetic formulas such as "2 + 3 * 4" or "(x + 1) * y". The
+Interpreter parses the text into a tree of Expression objects and evaluates it.
+
+Grammar (usual precedence, left associative):
+    expression := term (('+' | '-') term)*
+    term       := factor ('*' factor)*
+    factor     := number | name | '(' expression ')' | '-' factor
+
+--- Bytecode ---
+Walking the tree costs a virtual call per node. A formula that is evaluated
+many times can instead be compiled once into a flat Program for a small stack
+machine, whose loop only reads an array of instructions.
+
+--- Columns ---
+To apply one formula to many rows, bind each variable to a column in the
+Context and run the Program once over all rows. Each instruction then
+processes a block of rows at a time (vectorized with AVX2 when available), so
+the dispatch cost is paid per block instead of per row.
+
+--- Cache ---
+An Interpreter can share an ExpressionCache: a bounded, thread-safe map from
+expression text to its compiled Program with least-recently-used eviction.
+Repeated formulas are then parsed only once.
+
+--- Arena ---
+Trees the Interpreter builds itself live in an ExpressionArena: nodes are
+placed one after another in large blocks, and a single reset() destroys the
+whole tree and makes the memory reusable, instead of one delete per node.
+Nodes built in an arena do not own their children.
+
+--- Optimizer ---
+Before a tree is evaluated or compiled, an Optimizer rewrites it: constant
+subtrees are folded (2 + 3 * 4 becomes the single number 14), identities such
+as x + 0, x * 1 and x * 0 are applied, and equal subtrees are hash-consed into
+one shared node. Compiling the resulting DAG computes a shared subtree once and
+keeps it in a temporary. Folding wraps at 32 bits, as evaluation does. A
+variable that is multiplied by zero is no longer looked up, so it may be left
+unbound.
+
+--- Static expressions ---
+Formulas known when the program is built can be written with StaticNumber,
+StaticVariable and the operators +, - and *. Each formula is a type.
+Constant subtrees fold while compiling, and the rest inlines into
+straight-line code. The arithmetic is the same as the runtime interpreter's,
+and variables are read from a slot array the way Program::run reads them.
+*/
+
 #include <iostream>
 #include <string>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INTERPRETER_X86 1
+#endif
+
+// Integer arithmetic
+// Every evaluator (tree walk, bytecode, optimizer, column kernels and static
+// expressions) wraps around at 32 bits, so an expression gives the same result
+// however it is run, and overflow is never undefined.
+constexpr int wrappingAdd(int a, int b) {
+    return static_cast<int>(static_cast<std::uint32_t>(a) + static_cast<std::uint32_t>(b));
+}
+
+constexpr int wrappingSubtract(int a, int b) {
+    return static_cast<int>(static_cast<std::uint32_t>(a) - static_cast<std::uint32_t>(b));
+}
+
+constexpr int wrappingMultiply(int a, int b) {
+    return static_cast<int>(static_cast<std::uint32_t>(a) * static_cast<std::uint32_t>(b));
+}
 
 // Context
 class Context {
-    // Any global information needed for interpretation can be added here
+public:
+    struct Column {
+        const int* data;
+        std::size_t rows;
+    };
+
+private:
+    std::unordered_map<std::string, int> variables;
+    std::unordered_map<std::string, Column> columns;
+
+public:
+    void setVariable(const std::string& name, int value) {
+        variables[name] = value;
+    }
+
+    int getVariable(const std::string& name) const {
+        auto it = variables.find(name);
+        if (it == variables.end()) {
+            throw std::out_of_range("Unbound variable: " + name);
+        }
+        return it->second;
+    }
+
+    // The context does not copy the column: `data` must outlive its use
+    void bindColumn(const std::string& name, const int* data, std::size_t rows) {
+        columns[name] = Column{data, rows};
+    }
+
+    void bindColumn(const std::string& name, const std::vector<int>& data) {
+        bindColumn(name, data.data(), data.size());
+    }
+
+    const Column& getColumn(const std::string& name) const {
+        auto it = columns.find(name);
+        if (it == columns.end()) {
+            throw std::out_of_range("Unbound column: " + name);
+        }
+        return it->second;
+    }
+};
+
+// Column kernels
+// out[i] = a[i] op b[i]. Arithmetic wraps, as the 32-bit SIMD instructions do.
+struct ColumnKernels {
+    const char* name;
+    void (*add)(const int* a, const int* b, int* out, std::size_t n);
+    void (*subtract)(const int* a, const int* b, int* out, std::size_t n);
+    void (*multiply)(const int* a, const int* b, int* out, std::size_t n);
+};
+
+void addScalar(const int* a, const int* b, int* out, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) out[i] = wrappingAdd(a[i], b[i]);
+}
+
+void subtractScalar(const int* a, const int* b, int* out, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) out[i] = wrappingSubtract(a[i], b[i]);
+}
+
+void multiplyScalar(const int* a, const int* b, int* out, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) out[i] = wrappingMultiply(a[i], b[i]);
+}
+
+#ifdef INTERPRETER_X86
+__attribute__((target("avx2")))
+void addAvx2(const int* a, const int* b, int* out, std::size_t n) {
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_add_epi32(x, y));
+    }
+    addScalar(a + i, b + i, out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void subtractAvx2(const int* a, const int* b, int* out, std::size_t n) {
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_sub_epi32(x, y));
+    }
+    subtractScalar(a + i, b + i, out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void multiplyAvx2(const int* a, const int* b, int* out, std::size_t n) {
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_mullo_epi32(x, y));
+    }
+    multiplyScalar(a + i, b + i, out + i, n - i);
+}
+#endif
+
+const ColumnKernels kScalarColumnKernels{"scalar", addScalar, subtractScalar, multiplyScalar};
+#ifdef INTERPRETER_X86
+const ColumnKernels kAvx2ColumnKernels{"avx2", addAvx2, subtractAvx2, multiplyAvx2};
+#endif
+
+// Every kernel set this CPU can run, best first
+std::vector<const ColumnKernels*> availableColumnKernels() {
+    std::vector<const ColumnKernels*> kernels;
+#ifdef INTERPRETER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) kernels.push_back(&kAvx2ColumnKernels);
+#endif
+    kernels.push_back(&kScalarColumnKernels);
+    return kernels;
+}
+
+const ColumnKernels& columnKernels() {
+    static const ColumnKernels* best = availableColumnKernels().front();
+    return *best;
+}
+
+// Expression arena
+// Monotonic allocator for expression nodes. Every object is preceded by a small
+// header that links it to the previous one, so reset() can run the destructors
+// newest first without any bookkeeping allocation. Blocks are kept for reuse.
+class ExpressionArena {
+private:
+    struct Header {
+        void (*destroy)(void* object);
+        Header* previous;
+    };
+
+    struct Block {
+        std::unique_ptr<std::byte[]> memory;
+        std::size_t size;
+    };
+
+    static constexpr std::size_t kAlign = alignof(std::max_align_t);
+    static constexpr std::size_t kHeaderSize = (sizeof(Header) + kAlign - 1) / kAlign * kAlign;
+
+    std::vector<Block> blocks;
+    std::size_t current = 0;   // block being filled
+    std::size_t used = 0;      // bytes used in that block
+    Header* last = nullptr;
+
+    template <typename T>
+    static void destroyImpl(void* object) {
+        static_cast<T*>(object)->~T();
+    }
+
+    void* allocate(std::size_t bytes) {
+        bytes = (bytes + kAlign - 1) / kAlign * kAlign;
+        while (current < blocks.size() && used + bytes > blocks[current].size) {
+            ++current;
+            used = 0;
+        }
+        if (current == blocks.size()) {
+            std::size_t size = blocks.empty() ? 4096 : blocks.back().size * 2;
+            size = std::max(size, bytes);
+            blocks.push_back(Block{std::unique_ptr<std::byte[]>(new std::byte[size]), size});
+            used = 0;
+        }
+        void* result = blocks[current].memory.get() + used;
+        used += bytes;
+        return result;
+    }
+
+public:
+    ExpressionArena() = default;
+    ExpressionArena(const ExpressionArena&) = delete;
+    ExpressionArena& operator=(const ExpressionArena&) = delete;
+
+    ~ExpressionArena() { reset(); }
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        std::byte* memory = static_cast<std::byte*>(allocate(kHeaderSize + sizeof(T)));
+        T* object = new (memory + kHeaderSize) T(std::forward<Args>(args)...);
+        last = new (memory) Header{&destroyImpl<T>, last};
+        return object;
+    }
+
+    // Destroys every object made since the last reset
+    void reset() {
+        for (Header* header = last; header; header = header->previous) {
+            header->destroy(reinterpret_cast<std::byte*>(header) + kHeaderSize);
+        }
+        last = nullptr;
+        current = 0;
+        used = 0;
+    }
+
+    std::size_t bytesReserved() const {
+        std::size_t total = 0;
+        for (const Block& block : blocks) total += block.size;
+        return total;
+    }
+
+    // Resets the arena when the scope ends, also on exceptions
+    class Scope {
+    private:
+        ExpressionArena& arena;
+
+    public:
+        explicit Scope(ExpressionArena& arena) : arena(arena) {}
+        ~Scope() { arena.reset(); }
+    };
 };
 
+class Program;
+class Optimizer;
+
 // Abstract Expression Interface
 class Expression {
 public:
     virtual int interpret(Context& context) = 0;
+
+    // Appends the stack-machine code that leaves this expression's value on the stack
+    virtual void compile(Program& program) const = 0;
+
+    // Returns the optimizer's canonical node for this expression
+    virtual Expression* optimize(Optimizer& optimizer) const = 0;
+
     virtual ~Expression() {} // Virtual destructor for correct polymorphic behavior
 };
 
+// Program
+// Flat code for a stack machine. Variables are resolved to slots at compile
+// time, so running only needs an array of values in slot order.
+class Program {
+public:
+    enum class OpCode : std::uint8_t {
+        Push,   // push operand
+        Load,   // push values[operand]
+        Add,
+        Subtract,
+        Multiply,
+        Store,      // temps[operand] = top of stack, which stays in place
+        LoadTemp,   // push temps[operand]
+    };
+
+    struct Instruction {
+        OpCode op;
+        int operand;
+    };
+
+private:
+    static constexpr std::size_t kInlineStack = 64;
+
+    std::vector<Instruction> code;
+    std::vector<std::string> variables;   // slot -> name
+    std::size_t temps = 0;
+    std::size_t depth = 0;
+    std::size_t maxDepth = 0;
+
+    void adjustDepth(int delta) {
+        depth += delta;
+        if (depth > maxDepth) maxDepth = depth;
+    }
+
+    // Compile-time only: adds a slot for a variable seen for the first time
+    int internSlot(const std::string& name) {
+        int slot = findSlot(name);
+        if (slot >= 0) return slot;
+        variables.push_back(name);
+        return static_cast<int>(variables.size() - 1);
+    }
+
+    template <typename Stack>
+    int execute(const int* values, Stack* stack, Stack* tempValues) const {
+        Stack* top = stack;   // one past the last pushed value
+        for (const Instruction& instruction : code) {
+            switch (instruction.op) {
+            case OpCode::Push:     *top++ = instruction.operand; break;
+            case OpCode::Load:     *top++ = values[instruction.operand]; break;
+            case OpCode::Add:      --top; top[-1] = wrappingAdd(top[-1], top[0]); break;
+            case OpCode::Subtract: --top; top[-1] = wrappingSubtract(top[-1], top[0]); break;
+            case OpCode::Multiply: --top; top[-1] = wrappingMultiply(top[-1], top[0]); break;
+            case OpCode::Store:    tempValues[instruction.operand] = top[-1]; break;
+            case OpCode::LoadTemp: *top++ = tempValues[instruction.operand]; break;
+            }
+        }
+        return top[-1];
+    }
+
+public:
+    void emitPush(int value) {
+        code.push_back({OpCode::Push, value});
+        adjustDepth(+1);
+    }
+
+    void emitLoad(const std::string& name) {
+        code.push_back({OpCode::Load, internSlot(name)});
+        adjustDepth(+1);
+    }
+
+    void emitBinary(OpCode op) {
+        code.push_back({op, 0});
+        adjustDepth(-1);
+    }
+
+    // Saves the top of the stack in a new temporary and returns its index
+    int emitStore() {
+        int temp = static_cast<int>(temps++);
+        code.push_back({OpCode::Store, temp});
+        return temp;
+    }
+
+    void emitLoadTemp(int temp) {
+        code.push_back({OpCode::LoadTemp, temp});
+        adjustDepth(+1);
+    }
+
+    // Slot of `name` in a compiled program, or -1 if the program never reads it
+    // (for instance because the optimizer folded it away)
+    int findSlot(const std::string& name) const {
+        for (std::size_t i = 0; i < variables.size(); ++i) {
+            if (variables[i] == name) return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    const std::vector<std::string>& getVariables() const { return variables; }
+    const std::vector<Instruction>& getCode() const { return code; }
+
+    // Values for every slot, looked up in the context by name
+    std::vector<int> bind(const Context& context) const {
+        std::vector<int> values;
+        values.reserve(variables.size());
+        for (const auto& name : variables) values.push_back(context.getVariable(name));
+        return values;
+    }
+
+    // values[i] is the value of variable slot i
+    int run(const int* values) const {
+        // The temporaries live right above the stack
+        if (maxDepth + temps <= kInlineStack) {
+            int stack[kInlineStack];
+            return execute(values, stack, stack + maxDepth);
+        }
+        std::vector<int> stack(maxDepth + temps);
+        return execute(values, stack.data(), stack.data() + maxDepth);
+    }
+
+    int run(const Context& context) const {
+        if (variables.size() <= kInlineStack) {
+            int values[kInlineStack];
+            for (std::size_t i = 0; i < variables.size(); ++i) values[i] = context.getVariable(variables[i]);
+            return run(values);
+        }
+        std::vector<int> values = bind(context);
+        return run(values.data());
+    }
+
+    // Evaluates rows [0, rows) of the context's columns into out[0, rows).
+    // Works through blocks of kBlockRows so the intermediate columns stay in cache.
+    void runColumns(const Context& context, int* out, std::size_t rows,
+                    const ColumnKernels& kernels = columnKernels()) const {
+        static constexpr std::size_t kBlockRows = 1024;
+
+        std::vector<const int*> sources;
+        for (const auto& name : variables) {
+            const Context::Column& column = context.getColumn(name);
+            if (column.rows < rows) throw std::out_of_range("Column too short: " + name);
+            sources.push_back(column.data);
+        }
+
+        // One block-sized buffer per stack level, per temporary and per constant
+        std::size_t constants = 0;
+        for (const Instruction& instruction : code) constants += instruction.op == OpCode::Push;
+        std::vector<int> scratch((maxDepth + temps + constants) * kBlockRows);
+        int* tempBlocks = scratch.data() + maxDepth * kBlockRows;
+        std::vector<const int*> constantBlocks;
+        int* next = tempBlocks + temps * kBlockRows;
+        for (const Instruction& instruction : code) {
+            if (instruction.op != OpCode::Push) continue;
+            std::fill(next, next + kBlockRows, instruction.operand);
+            constantBlocks.push_back(next);
+            next += kBlockRows;
+        }
+
+        std::vector<const int*> stack(maxDepth);
+        for (std::size_t begin = 0; begin < rows; begin += kBlockRows) {
+            std::size_t n = std::min(kBlockRows, rows - begin);
+            std::size_t top = 0;
+            std::size_t constant = 0;
+            for (const Instruction& instruction : code) {
+                switch (instruction.op) {
+                case OpCode::Push: stack[top++] = constantBlocks[constant++]; break;
+                case OpCode::Load: stack[top++] = sources[instruction.operand] + begin; break;
+                case OpCode::Store: {
+                    // The stack level's block is reused later, so copy the rows out
+                    int* temp = tempBlocks + instruction.operand * kBlockRows;
+                    std::copy(stack[top - 1], stack[top - 1] + n, temp);
+                    stack[top - 1] = temp;
+                    break;
+                }
+                case OpCode::LoadTemp: stack[top++] = tempBlocks + instruction.operand * kBlockRows; break;
+                default: {
+                    // Results go to the scratch block of the stack level they land on
+                    --top;
+                    int* result = scratch.data() + (top - 1) * kBlockRows;
+                    const int* a = stack[top - 1];
+                    const int* b = stack[top];
+                    if (instruction.op == OpCode::Add) kernels.add(a, b, result, n);
+                    else if (instruction.op == OpCode::Subtract) kernels.subtract(a, b, result, n);
+                    else kernels.multiply(a, b, result, n);
+                    stack[top - 1] = result;
+                }
+                }
+            }
+            std::copy(stack[0], stack[0] + n, out + begin);
+        }
+    }
+};
+
 // Terminal Expression (NumberExpression)
 class NumberExpression : public Expression {
 private:
@@ -26,6 +516,31 @@ public:
     int interpret(Context& /*context*/) override {
         return number;
     }
+
+    void compile(Program& program) const override {
+        program.emitPush(number);
+    }
+
+    Expression* optimize(Optimizer& optimizer) const override;
+};
+
+// Terminal Expression (VariableExpression)
+class VariableExpression : public Expression {
+private:
+    std::string name;
+
+public:
+    VariableExpression(std::string name) : name(std::move(name)) {}
+
+    int interpret(Context& context) override {
+        return context.getVariable(name);
+    }
+
+    void compile(Program& program) const override {
+        program.emitLoad(name);
+    }
+
+    Expression* optimize(Optimizer& optimizer) const override;
 };
 
 // Non-Terminal Expression (AdditionExpression)
@@ -33,17 +548,62 @@ class AdditionExpression : public Expression {
 private:
     Expression* left;
     Expression* right;
+    bool ownsChildren;
 
 public:
-    AdditionExpression(Expression* left, Expression* right) : left(left), right(right) {}
+    // Nodes built in an ExpressionArena pass ownsChildren = false
+    AdditionExpression(Expression* left, Expression* right, bool ownsChildren = true)
+        : left(left), right(right), ownsChildren(ownsChildren) {}
 
     int interpret(Context& context) override {
-        return left->interpret(context) + right->interpret(context);
+        return wrappingAdd(left->interpret(context), right->interpret(context));
     }
 
+    void compile(Program& program) const override {
+        left->compile(program);
+        right->compile(program);
+        program.emitBinary(Program::OpCode::Add);
+    }
+
+    Expression* optimize(Optimizer& optimizer) const override;
+
     ~AdditionExpression() {
-        delete left;
-        delete right;
+        if (ownsChildren) {
+            delete left;
+            delete right;
+        }
+    }
+};
+
+// Non-Terminal Expression (SubtractionExpression)
+class SubtractionExpression : public Expression {
+private:
+    Expression* left;
+    Expression* right;
+    bool ownsChildren;
+
+public:
+    // Nodes built in an ExpressionArena pass ownsChildren = false
+    SubtractionExpression(Expression* left, Expression* right, bool ownsChildren = true)
+        : left(left), right(right), ownsChildren(ownsChildren) {}
+
+    int interpret(Context& context) override {
+        return wrappingSubtract(left->interpret(context), right->interpret(context));
+    }
+
+    void compile(Program& program) const override {
+        left->compile(program);
+        right->compile(program);
+        program.emitBinary(Program::OpCode::Subtract);
+    }
+
+    Expression* optimize(Optimizer& optimizer) const override;
+
+    ~SubtractionExpression() {
+        if (ownsChildren) {
+            delete left;
+            delete right;
+        }
     }
 };
 
@@ -52,17 +612,413 @@ class MultiplicationExpression : public Expression {
 private:
     Expression* left;
     Expression* right;
+    bool ownsChildren;
 
 public:
-    MultiplicationExpression(Expression* left, Expression* right) : left(left), right(right) {}
+    // Nodes built in an ExpressionArena pass ownsChildren = false
+    MultiplicationExpression(Expression* left, Expression* right, bool ownsChildren = true)
+        : left(left), right(right), ownsChildren(ownsChildren) {}
 
     int interpret(Context& context) override {
-        return left->interpret(context) * right->interpret(context);
+        return wrappingMultiply(left->interpret(context), right->interpret(context));
     }
 
+    void compile(Program& program) const override {
+        left->compile(program);
+        right->compile(program);
+        program.emitBinary(Program::OpCode::Multiply);
+    }
+
+    Expression* optimize(Optimizer& optimizer) const override;
+
     ~MultiplicationExpression() {
-        delete left;
-        delete right;
+        if (ownsChildren) {
+            delete left;
+            delete right;
+        }
+    }
+};
+
+// Optimizer
+// Builds canonical nodes in an arena. Every node is interned by its operator,
+// value or name and (already canonical) children, so equal subtrees share one
+// node and pointer equality means structural equality.
+class Optimizer {
+public:
+    using OpCode = Program::OpCode;
+
+private:
+    struct Key {
+        OpCode op;                  // Push for numbers, Load for variables
+        int value = 0;
+        Expression* left = nullptr;
+        Expression* right = nullptr;
+        std::string name;
+
+        explicit Key(OpCode op) : op(op) {}
+
+        bool operator==(const Key& other) const {
+            return op == other.op && value == other.value && left == other.left && right == other.right
+                && name == other.name;
+        }
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key& key) const {
+            std::size_t h = std::hash<std::string>()(key.name);
+            auto mix = [&h](std::size_t v) { h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2); };
+            mix(static_cast<std::size_t>(key.op));
+            mix(static_cast<std::size_t>(key.value));
+            mix(reinterpret_cast<std::uintptr_t>(key.left));
+            mix(reinterpret_cast<std::uintptr_t>(key.right));
+            return h;
+        }
+    };
+
+    struct Node {
+        Key key;
+        std::size_t id;     // creation order, used to order commutative operands
+        int uses = 0;       // parents in the DAG being compiled
+        int temp = -1;      // temporary holding the value, once computed
+    };
+
+    ExpressionArena& arena;
+    std::unordered_map<Key, Expression*, KeyHash> table;
+    std::unordered_map<const Expression*, Node> nodes;
+
+    static int apply(OpCode op, int a, int b) {
+        switch (op) {
+        case OpCode::Add:      return wrappingAdd(a, b);
+        case OpCode::Subtract: return wrappingSubtract(a, b);
+        default:               return wrappingMultiply(a, b);
+        }
+    }
+
+    Expression* intern(Key key) {
+        auto it = table.find(key);
+        if (it != table.end()) return it->second;
+
+        Expression* node;
+        switch (key.op) {
+        case OpCode::Push:     node = arena.make<NumberExpression>(key.value); break;
+        case OpCode::Load:     node = arena.make<VariableExpression>(key.name); break;
+        case OpCode::Add:      node = arena.make<AdditionExpression>(key.left, key.right, false); break;
+        case OpCode::Subtract: node = arena.make<SubtractionExpression>(key.left, key.right, false); break;
+        default:               node = arena.make<MultiplicationExpression>(key.left, key.right, false); break;
+        }
+        nodes.emplace(node, Node{key, nodes.size()});
+        table.emplace(std::move(key), node);
+        return node;
+    }
+
+    bool isConstant(const Expression* node, int* value = nullptr) const {
+        const Key& key = nodes.at(node).key;
+        if (key.op != OpCode::Push) return false;
+        if (value) *value = key.value;
+        return true;
+    }
+
+    static bool isBinary(OpCode op) {
+        return op == OpCode::Add || op == OpCode::Subtract || op == OpCode::Multiply;
+    }
+
+    void countUses(const Expression* node) {
+        Node& info = nodes.at(node);
+        if (info.uses++ > 0 || !isBinary(info.key.op)) return;
+        countUses(info.key.left);
+        countUses(info.key.right);
+    }
+
+    void emit(const Expression* node, Program& program) {
+        Node& info = nodes.at(node);
+        if (info.temp >= 0) {
+            program.emitLoadTemp(info.temp);
+            return;
+        }
+        switch (info.key.op) {
+        case OpCode::Push: program.emitPush(info.key.value); return;
+        case OpCode::Load: program.emitLoad(info.key.name); return;
+        default:
+            emit(info.key.left, program);
+            emit(info.key.right, program);
+            program.emitBinary(info.key.op);
+            if (info.uses > 1) info.temp = program.emitStore();
+        }
+    }
+
+public:
+    // Nodes are made in the arena and stay valid until it is reset
+    explicit Optimizer(ExpressionArena& arena) : arena(arena) {}
+
+    // Forgets every node, keeping the tables' buckets for the next expression.
+    // Call it whenever the arena is reset.
+    void clear() {
+        table.clear();
+        nodes.clear();
+    }
+
+    Expression* number(int value) {
+        Key key{OpCode::Push};
+        key.value = value;
+        return intern(std::move(key));
+    }
+
+    Expression* variable(const std::string& name) {
+        Key key{OpCode::Load};
+        key.name = name;
+        return intern(std::move(key));
+    }
+
+    // Both operands must already be canonical nodes of this optimizer
+    Expression* binary(OpCode op, Expression* left, Expression* right) {
+        int a = 0, b = 0;
+        bool leftConstant = isConstant(left, &a);
+        bool rightConstant = isConstant(right, &b);
+        if (leftConstant && rightConstant) return number(apply(op, a, b));
+
+        switch (op) {
+        case OpCode::Add:
+            if (rightConstant && b == 0) return left;
+            if (leftConstant && a == 0) return right;
+            break;
+        case OpCode::Subtract:
+            if (rightConstant && b == 0) return left;
+            if (left == right) return number(0);
+            break;
+        default:
+            if ((leftConstant && a == 0) || (rightConstant && b == 0)) return number(0);
+            if (rightConstant && b == 1) return left;
+            if (leftConstant && a == 1) return right;
+            break;
+        }
+
+        if (op != OpCode::Subtract) {
+            // Constants go right, other operands in creation order, so x * y and y * x meet
+            if (leftConstant || (!rightConstant && nodes.at(left).id > nodes.at(right).id)) {
+                std::swap(left, right);
+                std::swap(leftConstant, rightConstant);
+                std::swap(a, b);
+            }
+            // (e + c1) + c2 -> e + (c1 + c2), and likewise for *
+            const Key& inner = nodes.at(left).key;
+            int c = 0;
+            if (rightConstant && inner.op == op && isConstant(inner.right, &c)) {
+                return binary(op, inner.left, number(apply(op, c, b)));
+            }
+        }
+
+        Key key{op};
+        key.left = left;
+        key.right = right;
+        return intern(std::move(key));
+    }
+
+    Expression* optimize(const Expression& tree) {
+        return tree.optimize(*this);
+    }
+
+    // Appends code for a node returned by this optimizer. Subtrees used more
+    // than once are computed once and reloaded from a temporary.
+    void compile(const Expression* root, Program& program) {
+        for (auto& entry : nodes) {
+            entry.second.uses = 0;
+            entry.second.temp = -1;
+        }
+        countUses(root);
+        emit(root, program);
+    }
+
+    std::size_t nodeCount() const { return nodes.size(); }
+};
+
+Expression* NumberExpression::optimize(Optimizer& optimizer) const {
+    return optimizer.number(number);
+}
+
+Expression* VariableExpression::optimize(Optimizer& optimizer) const {
+    return optimizer.variable(name);
+}
+
+Expression* AdditionExpression::optimize(Optimizer& optimizer) const {
+    return optimizer.binary(Program::OpCode::Add, left->optimize(optimizer), right->optimize(optimizer));
+}
+
+Expression* SubtractionExpression::optimize(Optimizer& optimizer) const {
+    return optimizer.binary(Program::OpCode::Subtract, left->optimize(optimizer), right->optimize(optimizer));
+}
+
+Expression* MultiplicationExpression::optimize(Optimizer& optimizer) const {
+    return optimizer.binary(Program::OpCode::Multiply, left->optimize(optimizer), right->optimize(optimizer));
+}
+
+// Parser
+// Precedence climbing over the grammar at the top of the file. Throws
+// std::invalid_argument with the offending position on malformed input.
+class Parser {
+private:
+    const std::string& text;
+    std::size_t pos = 0;
+    ExpressionArena* arena;
+
+    // Arena nodes are released by the arena, never deleted one by one
+    struct NodeDeleter {
+        bool inArena;
+        void operator()(Expression* node) const {
+            if (!inArena) delete node;
+        }
+    };
+    using NodePtr = std::unique_ptr<Expression, NodeDeleter>;
+
+    template <typename T, typename... Args>
+    NodePtr makeLeaf(Args&&... args) {
+        if (arena) return NodePtr(arena->make<T>(std::forward<Args>(args)...), NodeDeleter{true});
+        return NodePtr(new T(std::forward<Args>(args)...), NodeDeleter{false});
+    }
+
+    template <typename T>
+    NodePtr makeBinary(NodePtr left, NodePtr right) {
+        if (arena) return NodePtr(arena->make<T>(left.release(), right.release(), false), NodeDeleter{true});
+        return NodePtr(new T(left.release(), right.release()), NodeDeleter{false});
+    }
+
+    static int precedence(char op) {
+        switch (op) {
+        case '+': case '-': return 1;
+        case '*': return 2;
+        default: return 0;
+        }
+    }
+
+    void skipSpaces() {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) ++pos;
+    }
+
+    char peek() {
+        skipSpaces();
+        return pos < text.size() ? text[pos] : '\0';
+    }
+
+    [[noreturn]] void fail(const std::string& message) {
+        throw std::invalid_argument(message + " at position " + std::to_string(pos) + " in \"" + text + "\"");
+    }
+
+    NodePtr combine(char op, NodePtr left, NodePtr right) {
+        switch (op) {
+        case '+': return makeBinary<AdditionExpression>(std::move(left), std::move(right));
+        case '-': return makeBinary<SubtractionExpression>(std::move(left), std::move(right));
+        default:  return makeBinary<MultiplicationExpression>(std::move(left), std::move(right));
+        }
+    }
+
+    NodePtr parseFactor() {
+        char c = peek();
+        if (std::isdigit(static_cast<unsigned char>(c))) {
+            long long value = 0;
+            while (pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos]))) {
+                value = value * 10 + (text[pos++] - '0');
+                if (value > INT32_MAX) fail("Number too large");
+            }
+            return makeLeaf<NumberExpression>(static_cast<int>(value));
+        }
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            std::size_t start = pos;
+            while (pos < text.size() && (std::isalnum(static_cast<unsigned char>(text[pos])) || text[pos] == '_')) ++pos;
+            return makeLeaf<VariableExpression>(text.substr(start, pos - start));
+        }
+        if (c == '(') {
+            ++pos;
+            auto inner = parseExpression(1);
+            if (peek() != ')') fail("Expected ')'");
+            ++pos;
+            return inner;
+        }
+        if (c == '-') {
+            ++pos;
+            return combine('-', makeLeaf<NumberExpression>(0), parseFactor());
+        }
+        fail(c == '\0' ? "Unexpected end of input" : std::string("Unexpected '") + c + "'");
+    }
+
+    // Parses operators that bind at least as tightly as minPrecedence
+    NodePtr parseExpression(int minPrecedence) {
+        auto left = parseFactor();
+        while (true) {
+            char op = peek();
+            int prec = precedence(op);
+            if (prec == 0 || prec < minPrecedence) return left;
+            ++pos;
+            auto right = parseExpression(prec + 1);
+            left = combine(op, std::move(left), std::move(right));
+        }
+    }
+
+public:
+    // Without an arena the caller owns the returned tree. With one, the tree
+    // lives until the arena is reset.
+    explicit Parser(const std::string& text, ExpressionArena* arena = nullptr) : text(text), arena(arena) {}
+
+    Expression* parse() {
+        auto tree = parseExpression(1);
+        if (peek() != '\0') fail(std::string("Unexpected '") + peek() + "'");
+        return tree.release();
+    }
+};
+
+// Expression cache
+// Maps expression text to its compiled Program. Safe to share between threads;
+// parsing happens outside the lock, so two threads may compile the same text
+// once each, and the first one to finish is kept.
+class ExpressionCache {
+private:
+    using Entry = std::pair<std::string, std::shared_ptr<const Program>>;
+
+    std::size_t capacity;
+    std::list<Entry> entries;   // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    mutable std::mutex mutex;
+    std::atomic<std::uint64_t> hits{0};
+    std::atomic<std::uint64_t> misses{0};
+
+public:
+    explicit ExpressionCache(std::size_t capacity) : capacity(std::max<std::size_t>(capacity, 1)) {}
+
+    std::shared_ptr<const Program> get(const std::string& expression) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = index.find(expression);
+            if (it != index.end()) {
+                entries.splice(entries.begin(), entries, it->second);
+                ++hits;
+                return it->second->second;
+            }
+        }
+        ++misses;
+
+        auto program = std::make_shared<Program>();
+        {
+            ExpressionArena arena;
+            Optimizer optimizer(arena);
+            optimizer.compile(optimizer.optimize(*Parser(expression, &arena).parse()), *program);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(expression);
+        if (it != index.end()) return it->second->second;
+        entries.emplace_front(expression, std::move(program));
+        index.emplace(expression, entries.begin());
+        if (entries.size() > capacity) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+        return entries.front().second;
+    }
+
+    std::uint64_t hitCount() const { return hits; }
+    std::uint64_t missCount() const { return misses; }
+
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
     }
 };
 
@@ -70,49 +1026,490 @@ public:
 class Interpreter {
 private:
     Context* context;
+    ExpressionCache* cache;
+    ExpressionArena arena;   // holds the tree of the call in progress
+    Optimizer optimizer{arena};   // cleared at the start of every call
 
 public:
-    Interpreter(Context* context) : context(context) {}
+    // With a cache, interpret() runs the cached bytecode instead of parsing
+    Interpreter(Context* context, ExpressionCache* cache = nullptr) : context(context), cache(cache) {}
 
     int interpret(const std::string& expression) {
-        // For simplicity, assuming expression is parsed and directly creating the expression tree
+        if (cache) {
+            return cache->get(expression)->run(*context);
+        }
+
+        // The tree is freed in one go when the scope ends
+        ExpressionArena::Scope scope(arena);
+
+        optimizer.clear();
+        // Parse the expression into a tree
         Expression* expressionTree = buildExpressionTree(expression);
-        
-        // Interpret expression tree
-        int result = expressionTree->interpret(*context);
 
-        delete expressionTree;
+        // Rewrite it, then interpret the optimized tree
+        return optimizer.optimize(*expressionTree)->interpret(*context);
+    }
 
-        return result;
+    // Parses once into bytecode that can be run many times
+    Program compile(const std::string& expression) {
+        ExpressionArena::Scope scope(arena);
+        optimizer.clear();
+        Expression* expressionTree = buildExpressionTree(expression);
+        Program program;
+        optimizer.compile(optimizer.optimize(*expressionTree), program);
+        return program;
     }
 
 private:
-    Expression* buildExpressionTree(const std::string& /*expression*/) {
-        // Logic to parse expression and create expression tree
-        // For simplicity, hardcoding an expression tree
-        return new AdditionExpression(
-            new NumberExpression(2),
-            new MultiplicationExpression(
-                new NumberExpression(3),
-                new NumberExpression(4)
-            )
-        );
+    Expression* buildExpressionTree(const std::string& expression) {
+        return Parser(expression, &arena).parse();
+    }
+};
+
+// Static expressions
+// Compile-time counterparts of the Expression classes. They are empty types,
+// so a formula is written as an expression of objects and its type is used.
+constexpr int staticApply(Program::OpCode op, int a, int b) {
+    return op == Program::OpCode::Add        ? wrappingAdd(a, b)
+           : op == Program::OpCode::Subtract ? wrappingSubtract(a, b)
+                                             : wrappingMultiply(a, b);
+}
+
+// Terminal Expression (StaticNumber)
+template <int N>
+struct StaticNumber {
+    static constexpr bool isConstant = true;
+    static constexpr int value = N;
+
+    static constexpr int evaluate(const int* /*values*/) { return N; }
+};
+
+// Terminal Expression (StaticVariable), read from values[Slot]
+template <int Slot>
+struct StaticVariable {
+    static constexpr bool isConstant = false;
+
+    static constexpr int evaluate(const int* values) { return values[Slot]; }
+};
+
+// Non-Terminal Expression (StaticAddition, StaticSubtraction, StaticMultiplication)
+template <Program::OpCode Op, typename Left, typename Right>
+struct StaticBinary {
+    static constexpr bool isConstant = false;
+
+    static constexpr int evaluate(const int* values) {
+        return staticApply(Op, Left::evaluate(values), Right::evaluate(values));
     }
 };
 
+template <typename Left, typename Right>
+using StaticAddition = StaticBinary<Program::OpCode::Add, Left, Right>;
+template <typename Left, typename Right>
+using StaticSubtraction = StaticBinary<Program::OpCode::Subtract, Left, Right>;
+template <typename Left, typename Right>
+using StaticMultiplication = StaticBinary<Program::OpCode::Multiply, Left, Right>;
+
+template <typename T>
+struct IsStaticExpression : std::false_type {};
+template <int N>
+struct IsStaticExpression<StaticNumber<N>> : std::true_type {};
+template <int Slot>
+struct IsStaticExpression<StaticVariable<Slot>> : std::true_type {};
+template <Program::OpCode Op, typename Left, typename Right>
+struct IsStaticExpression<StaticBinary<Op, Left, Right>> : std::true_type {};
+
+// Two constants combine into a StaticNumber, anything else into a StaticBinary
+template <Program::OpCode Op, typename Left, typename Right, bool Fold = Left::isConstant && Right::isConstant>
+struct StaticCombine {
+    using type = StaticBinary<Op, Left, Right>;
+};
+
+template <Program::OpCode Op, typename Left, typename Right>
+struct StaticCombine<Op, Left, Right, true> {
+    using type = StaticNumber<staticApply(Op, Left::value, Right::value)>;
+};
+
+template <typename Left, typename Right>
+using EnableIfStatic = std::enable_if_t<IsStaticExpression<Left>::value && IsStaticExpression<Right>::value>;
+
+template <typename Left, typename Right, typename = EnableIfStatic<Left, Right>>
+constexpr typename StaticCombine<Program::OpCode::Add, Left, Right>::type operator+(Left, Right) {
+    return {};
+}
+
+template <typename Left, typename Right, typename = EnableIfStatic<Left, Right>>
+constexpr typename StaticCombine<Program::OpCode::Subtract, Left, Right>::type operator-(Left, Right) {
+    return {};
+}
+
+template <typename Left, typename Right, typename = EnableIfStatic<Left, Right>>
+constexpr typename StaticCombine<Program::OpCode::Multiply, Left, Right>::type operator*(Left, Right) {
+    return {};
+}
+
+// -e is 0 - e, as in the parser
+template <typename Operand, typename = EnableIfStatic<Operand, Operand>>
+constexpr typename StaticCombine<Program::OpCode::Subtract, StaticNumber<0>, Operand>::type operator-(Operand) {
+    return {};
+}
+
+template <int N>
+constexpr StaticNumber<N> staticNumber{};
+
+template <int Slot>
+constexpr StaticVariable<Slot> staticVariable{};
+
+// Benchmark
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void runBenchmark(int iterations) {
+    const std::string formula = "(x + 3) * (y - 2) * 4 + x * y - 7 * (x - y) + 2 * 3 * 4";
+    std::cout << "Benchmark: " << formula << ", " << iterations << " evaluations\n";
+
+    Context context;
+    std::unique_ptr<Expression> tree(Parser(formula).parse());
+    long long treeSum = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        context.setVariable("x", i & 1023);
+        context.setVariable("y", i & 511);
+        treeSum += tree->interpret(context);
+    }
+    double treeSeconds = secondsSince(start);
+
+    Interpreter interpreter(&context);
+    Program program = interpreter.compile(formula);
+    long long bytecodeSum = 0;
+    std::vector<int> values(program.getVariables().size());
+    int xSlot = program.findSlot("x");
+    int ySlot = program.findSlot("y");
+    if (xSlot < 0 || ySlot < 0) throw std::logic_error("benchmark formula must read x and y");
+    start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        values[xSlot] = i & 1023;
+        values[ySlot] = i & 511;
+        bytecodeSum += program.run(values.data());
+    }
+    double bytecodeSeconds = secondsSince(start);
+
+    std::cout << "  tree walk: " << iterations / treeSeconds / 1e6 << " M evals/s\n"
+              << "  bytecode:  " << iterations / bytecodeSeconds / 1e6 << " M evals/s ("
+              << program.getCode().size() << " instructions)\n"
+              << "  checksums: " << treeSum << " / " << bytecodeSum << "\n";
+}
+
+void runColumnBenchmark(std::size_t rows) {
+    const std::string formula = "(x + 3) * (y - 2) * 4 + x * y - 7 * (x - y) + 2 * 3 * 4";
+    std::cout << "Column benchmark: " << rows << " rows\n";
+
+    std::vector<int> xs(rows), ys(rows), out(rows);
+    for (std::size_t i = 0; i < rows; ++i) {
+        xs[i] = static_cast<int>(i & 1023);
+        ys[i] = static_cast<int>(i & 511);
+    }
+
+    Context context;
+    context.bindColumn("x", xs);
+    context.bindColumn("y", ys);
+    Interpreter interpreter(&context);
+    Program program = interpreter.compile(formula);
+
+    // Per row: set the variables and walk the tree
+    std::unique_ptr<Expression> tree(Parser(formula).parse());
+    long long rowSum = 0;
+    auto start = Clock::now();
+    for (std::size_t i = 0; i < rows; ++i) {
+        context.setVariable("x", xs[i]);
+        context.setVariable("y", ys[i]);
+        rowSum += tree->interpret(context);
+    }
+    std::cout << "  per-row interpret(): " << rows / secondsSince(start) / 1e6 << " M rows/s\n";
+
+    for (const ColumnKernels* kernels : availableColumnKernels()) {
+        start = Clock::now();
+        program.runColumns(context, out.data(), rows, *kernels);
+        double seconds = secondsSince(start);
+        long long columnSum = 0;
+        for (int v : out) columnSum += v;
+        std::cout << "  columns (" << kernels->name << "): " << rows / seconds / 1e6 << " M rows/s"
+                  << (columnSum == rowSum ? "" : "  (MISMATCH)") << "\n";
+    }
+}
+
+// A few thousand distinct formulas, each repeated many times
+void runCacheBenchmark(int calls) {
+    const int distinct = 2000;
+    std::vector<std::string> formulas;
+    for (int i = 0; i < distinct; ++i) {
+        formulas.push_back("x * " + std::to_string(i % 97) + " + (y - " + std::to_string(i) + ") * (x + "
+                           + std::to_string(i % 13) + ") - 3 * y");
+    }
+    std::cout << "Cache benchmark: " << distinct << " formulas, " << calls << " calls\n";
+
+    auto measure = [&](const char* name, ExpressionCache* cache, int threads) {
+        std::atomic<long long> total{0};
+        auto start = Clock::now();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                Context context;
+                context.setVariable("x", 3);
+                context.setVariable("y", 4);
+                Interpreter interpreter(&context, cache);
+                long long sum = 0;
+                std::uint32_t state = 12345u + t;
+                for (int i = t; i < calls; i += threads) {
+                    state = state * 1664525u + 1013904223u;
+                    sum += interpreter.interpret(formulas[(state >> 8) % distinct]);
+                }
+                total += sum;
+            });
+        }
+        for (auto& w : workers) w.join();
+        double seconds = secondsSince(start);
+        std::cout << "  " << name << ": " << seconds / calls * 1e9 << " ns/call";
+        if (cache) {
+            double lookups = static_cast<double>(cache->hitCount() + cache->missCount());
+            std::cout << ", hit rate " << 100.0 * cache->hitCount() / lookups << "%";
+        }
+        std::cout << ", checksum " << total << "\n";
+    };
+
+    measure("no cache          ", nullptr, 1);
+    ExpressionCache big(4096);
+    measure("cache 4096        ", &big, 1);
+    ExpressionCache small(1000);
+    measure("cache 1000 (evicts)", &small, 1);
+    ExpressionCache shared(4096);
+    measure("cache 4096, 4 threads", &shared, 4);
+}
+
+// Parse, evaluate and free the same formula over and over
+void runArenaBenchmark(int cycles) {
+    const std::string formula = "(x + 3) * (y - 2) * 4 + x * y - 7 * (x - y) + 2 * 3 * 4";
+    std::cout << "Arena benchmark: " << cycles << " build + evaluate + destroy cycles\n";
+    Context context;
+    context.setVariable("x", 5);
+    context.setVariable("y", 9);
+
+    long long heapSum = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < cycles; ++i) {
+        Expression* tree = Parser(formula).parse();
+        heapSum += tree->interpret(context);
+        delete tree;
+    }
+    double heapSeconds = secondsSince(start);
+
+    ExpressionArena arena;
+    long long arenaSum = 0;
+    start = Clock::now();
+    for (int i = 0; i < cycles; ++i) {
+        Expression* tree = Parser(formula, &arena).parse();
+        arenaSum += tree->interpret(context);
+        arena.reset();
+    }
+    double arenaSeconds = secondsSince(start);
+
+    std::cout << "  new/delete: " << cycles / heapSeconds / 1e6 << " M cycles/s\n"
+              << "  arena:      " << cycles / arenaSeconds / 1e6 << " M cycles/s ("
+              << arena.bytesReserved() << " bytes reserved)\n"
+              << "  checksums: " << heapSum << " / " << arenaSum << "\n";
+}
+
+// A generated formula whose terms repeat the same few subexpressions
+void runOptimizerBenchmark(int iterations) {
+    std::string formula;
+    for (int i = 0; i < 40; ++i) {
+        if (i) formula += " + ";
+        formula += "(x + y) * (x - y) + (y * x + " + std::to_string(i % 4) + ") * 2 * 1 + 0 * (x - "
+                   + std::to_string(i) + ") + (3 * 4 - 12) * y";
+    }
+    std::cout << "Optimizer benchmark: " << formula.size() << "-character generated formula, "
+              << iterations << " evaluations\n";
+
+    std::unique_ptr<Expression> tree(Parser(formula).parse());
+    Program plain;
+    tree->compile(plain);
+
+    ExpressionArena arena;
+    Optimizer optimizer(arena);
+    Expression* optimized = optimizer.optimize(*tree);
+    Program program;
+    optimizer.compile(optimized, program);
+
+    Context context;
+    auto measureTree = [&](const char* name, Expression* root) {
+        long long sum = 0;
+        auto start = Clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            context.setVariable("x", i & 1023);
+            context.setVariable("y", i & 511);
+            sum += root->interpret(context);
+        }
+        std::cout << "  " << name << iterations / secondsSince(start) / 1e6 << " M evals/s, checksum " << sum << "\n";
+    };
+    auto measureProgram = [&](const char* name, const Program& code) {
+        long long sum = 0;
+        std::vector<int> values(std::max<std::size_t>(code.getVariables().size(), 2));
+        int xSlot = code.findSlot("x");
+        int ySlot = code.findSlot("y");
+        if (xSlot < 0 || ySlot < 0) throw std::logic_error("benchmark formula must read x and y");
+        auto start = Clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            values[xSlot] = i & 1023;
+            values[ySlot] = i & 511;
+            sum += code.run(values.data());
+        }
+        std::cout << "  " << name << iterations / secondsSince(start) / 1e6 << " M evals/s ("
+                  << code.getCode().size() << " instructions), checksum " << sum << "\n";
+    };
+
+    measureTree("tree walk:           ", tree.get());
+    measureTree("optimized tree walk: ", optimized);
+    measureProgram("bytecode:            ", plain);
+    measureProgram("optimized bytecode:  ", program);
+    std::cout << "  " << optimizer.nodeCount() << " distinct nodes after optimization\n";
+}
+
+// The benchmark formula written as a type
+void runStaticBenchmark(int iterations) {
+    const std::string text = "(x + 3) * (y - 2) * 4 + x * y - 7 * (x - y) + 2 * 3 * 4";
+    std::cout << "Static benchmark: " << text << ", " << iterations << " evaluations\n";
+
+    constexpr auto x = staticVariable<0>;
+    constexpr auto y = staticVariable<1>;
+    constexpr auto formula = (x + staticNumber<3>) * (y - staticNumber<2>) * staticNumber<4> + x * y
+                             - staticNumber<7> * (x - y) + staticNumber<2> * staticNumber<3> * staticNumber<4>;
+    // Fails to compile unless the formula can be evaluated by the compiler.
+    // Whether it agrees with the interpreter is checked below.
+    constexpr int atCompileTime = decltype(formula)::evaluate(std::array<int, 2>{5, 9}.data());
+    static_cast<void>(atCompileTime);
+
+    Context context;
+    std::unique_ptr<Expression> tree(Parser(text).parse());
+    Program program = Interpreter(&context).compile(text);
+    std::vector<int> values(std::max<std::size_t>(program.getVariables().size(), 2));
+    int xSlot = program.findSlot("x");
+    int ySlot = program.findSlot("y");
+    if (xSlot < 0 || ySlot < 0) throw std::logic_error("benchmark formula must read x and y");
+
+    // The inputs below repeat every 1024 iterations; the static formula must
+    // agree with the parsed tree and the bytecode on each of them
+    for (int i = 0; i < 1024; ++i) {
+        context.setVariable("x", i & 1023);
+        context.setVariable("y", i & 511);
+        values[xSlot] = i & 1023;
+        values[ySlot] = i & 511;
+        int expected = tree->interpret(context);
+        std::array<int, 2> staticValues{i & 1023, i & 511};
+        if (program.run(values.data()) != expected || formula.evaluate(staticValues.data()) != expected) {
+            throw std::logic_error("static formula does not match the interpreter");
+        }
+    }
+
+    long long treeSum = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        context.setVariable("x", i & 1023);
+        context.setVariable("y", i & 511);
+        treeSum += tree->interpret(context);
+    }
+    double treeSeconds = secondsSince(start);
+
+    long long bytecodeSum = 0;
+    start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        values[xSlot] = i & 1023;
+        values[ySlot] = i & 511;
+        bytecodeSum += program.run(values.data());
+    }
+    double bytecodeSeconds = secondsSince(start);
+
+    long long staticSum = 0;
+    start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        values[0] = i & 1023;
+        values[1] = i & 511;
+        staticSum += formula.evaluate(values.data());
+    }
+    double staticSeconds = secondsSince(start);
+
+    std::cout << "  tree walk: " << iterations / treeSeconds / 1e6 << " M evals/s\n"
+              << "  bytecode:  " << iterations / bytecodeSeconds / 1e6 << " M evals/s\n"
+              << "  static:    " << iterations / staticSeconds / 1e6 << " M evals/s\n"
+              << "  checksums: " << treeSum << " / " << bytecodeSum << " / " << staticSum << "\n";
+}
+
 // Client (Main function)
-int main() {
+// Usage: interpreter [--bench [iterations]]
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        runBenchmark(argc > 2 ? std::atoi(argv[2]) : 5000000);
+        runColumnBenchmark(argc > 2 ? std::atoi(argv[2]) : 5000000);
+        runCacheBenchmark(argc > 2 ? std::atoi(argv[2]) : 5000000);
+        runArenaBenchmark(argc > 2 ? std::atoi(argv[2]) / 5 : 1000000);
+        runOptimizerBenchmark(argc > 2 ? std::atoi(argv[2]) / 50 : 100000);
+        runStaticBenchmark(argc > 2 ? std::atoi(argv[2]) : 5000000);
+        return 0;
+    }
+
     // Input expression
     std::string expression = "2 + 3 * 4";
-    
+
     // Create interpreter
     Context* context = new Context();
     Interpreter interpreter(context);
-    
+
     // Interpret expression
     int result = interpreter.interpret(expression);
     std::cout << "Result: " << result << std::endl;
 
+    // Constant subtrees fold away before anything is evaluated
+    std::cout << expression << " compiles to " << interpreter.compile(expression).getCode().size()
+              << " instruction(s)" << std::endl;
+
+    // Known at build time: the whole formula is a single constant
+    using Folded = decltype(staticNumber<2> + staticNumber<3> * staticNumber<4>);
+    static_assert(Folded::value == 14, "2 + 3 * 4 folds at compile time");
+    std::cout << expression << " as a static expression: " << Folded::value << std::endl;
+
+    // Variables come from the context; bytecode gives the same answer
+    context->setVariable("x", 5);
+    context->setVariable("y", 7);
+    std::string formula = "(x + 1) * -y - 2 * (3 - x)";
+    Program program = interpreter.compile(formula);
+    std::cout << formula << " = " << interpreter.interpret(formula)
+              << " (bytecode: " << program.run(*context) << ")" << std::endl;
+
+    // The same formula over a whole column of rows
+    std::vector<int> xs = {1, 2, 3, 4, 5};
+    std::vector<int> ys = {10, 20, 30, 40, 50};
+    std::vector<int> results(xs.size());
+    context->bindColumn("x", xs);
+    context->bindColumn("y", ys);
+    program.runColumns(*context, results.data(), results.size());
+    std::cout << formula << " over columns:";
+    for (int r : results) std::cout << " " << r;
+    std::cout << std::endl;
+
+    // Repeated formulas are parsed once
+    ExpressionCache cache(128);
+    Interpreter cachedInterpreter(context, &cache);
+    for (int i = 0; i < 3; ++i) cachedInterpreter.interpret(formula);
+    cachedInterpreter.interpret(expression);
+    std::cout << "Cache: " << cache.hitCount() << " hits, " << cache.missCount() << " misses" << std::endl;
+
+    try {
+        interpreter.interpret("2 + * 3");
+    } catch (const std::invalid_argument& e) {
+        std::cout << "Error: " << e.what() << std::endl;
+    }
+
     delete context;
 
     return 0;
@@ -2,21 +2,95 @@
 
 #include <iostream>
 #include <string>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 /*
 --- Problem Statement ---
-The Mediator Design Pattern in C++ is a behavioral pattern that defines an 
-object, the mediator, to centralize communication between various components 
-or objects in a system. This promotes loose coupling by preventing direct 
-interactions between components, instead of having them communicate through 
-the mediator, facilitating better maintainability and flexibility in the 
-system architecture. 
+The Mediator Design Pattern in C++ is a behavioral pattern that defines an
+object, the mediator, to centralize communication between various components
+or objects in a system. This promotes loose coupling by preventing direct
+interactions between components, instead of having them communicate through
+the mediator, facilitating better maintainability and flexibility in the
+system architecture.
+
+--- Runway scheduling ---
+The control tower assigns runway slots. Waiting requests sit in a priority
+queue ordered by priority (emergencies, then landings, then takeoffs) and then
+by request time. Whenever a runway can take the next operation, the head of
+the queue gets the runway where it can start soonest. Consecutive operations on
+one runway are kept apart by a separation that covers runway occupancy and wake
+turbulence behind heavier aircraft. A request costs O(log n) for n waiting
+airplanes. Time is in seconds of tower time, advanced by the caller. A slot
+never starts before the tower time it is assigned at, so a caller that jumps
+ahead gets late slots; stepping to nextSlot() keeps every slot on time.
+
+--- Mailboxes ---
+A MailboxControlTower does not build a string for every notification.
+Message texts are interned once in a MessageCatalog, and a Message is a small
+fixed-size struct holding the text id and the variable parts. Each registered
+colleague has a bounded lock-free mailbox that any thread can post to.
+deliver() drains the mailboxes and hands each colleague a batch at a time.
+Neither posting nor delivery allocates.
 */
 
 // Forward declaration
 class Airplane;
 
+enum class RunwayOperation : std::uint8_t { Takeoff, Landing };
+
+enum class WakeCategory : std::uint8_t { Light, Medium, Heavy };
+
+// A runway slot given to an airplane
+struct Clearance {
+    Airplane* airplane;
+    RunwayOperation operation;
+    WakeCategory wake;
+    int runway;
+    double requestedAt;
+    double slot;   // start of the operation
+};
+
+// Message texts, each stored once and referred to by id. Intern every text
+// before messages start to flow; lookups are then read-only.
+class MessageCatalog {
+private:
+    std::vector<std::string> texts;
+    std::unordered_map<std::string, std::uint32_t> ids;
+
+public:
+    std::uint32_t intern(const std::string& text) {
+        auto it = ids.find(text);
+        if (it != ids.end()) return it->second;
+        texts.push_back(text);
+        return ids[text] = static_cast<std::uint32_t>(texts.size() - 1);
+    }
+
+    const std::string& text(std::uint32_t id) const { return texts.at(id); }
+};
+
+// Fixed-size message: an interned text plus the parts that vary
+struct Message {
+    std::uint32_t text;      // MessageCatalog id
+    std::int32_t argument;   // e.g. a runway number
+    double time;
+    const Airplane* sender;  // nullptr when the tower sends it
+};
+
 // Mediator Interface
 class AirTrafficControlTower {
 public:
@@ -33,19 +107,313 @@ public:
     virtual void requestLanding() = 0;
     virtual void notifyAirTrafficControl(const std::string& message) = 0;
 
+    // What the tower needs for sequencing
+    virtual WakeCategory getWakeCategory() const { return WakeCategory::Medium; }
+    virtual bool isEmergency() const { return false; }
+
+    // Called by the tower once a slot is assigned
+    virtual void clearedFor(const Clearance& clearance) {
+        std::ostringstream message;
+        message << "Cleared for " << (clearance.operation == RunwayOperation::Takeoff ? "takeoff" : "landing")
+                << " on runway " << clearance.runway + 1 << " at t=" << clearance.slot << "s.";
+        notifyAirTrafficControl(message.str());
+    }
+
+    // Called by a MailboxControlTower with a batch of messages. The catalog
+    // already holds the texts, so passing them on does not allocate.
+    virtual void receive(const Message* messages, std::size_t count, const MessageCatalog& catalog) {
+        for (std::size_t i = 0; i < count; ++i) notifyAirTrafficControl(catalog.text(messages[i].text));
+    }
+
     virtual ~Airplane() = default;
 };
 
+// Runway scheduler
+class RunwayScheduler {
+private:
+    struct Request {
+        Airplane* airplane;
+        RunwayOperation operation;
+        WakeCategory wake;
+        std::uint8_t priority;   // 2 emergency, 1 landing, 0 takeoff
+        double time;
+        std::uint64_t sequence;  // ties go to the earlier request
+    };
+
+    // std::priority_queue keeps the greatest on top
+    struct LowerPriority {
+        bool operator()(const Request& a, const Request& b) const {
+            if (a.priority != b.priority) return a.priority < b.priority;
+            if (a.time != b.time) return a.time > b.time;
+            return a.sequence > b.sequence;
+        }
+    };
+
+    struct Runway {
+        bool used = false;
+        RunwayOperation operation = RunwayOperation::Takeoff;
+        WakeCategory wake = WakeCategory::Light;
+        double slot = 0;
+    };
+
+    std::priority_queue<Request, std::vector<Request>, LowerPriority> pending;
+    std::vector<Runway> runways;
+    std::uint64_t nextSequence = 0;
+
+    double earliestStart(const Runway& runway, const Request& request) const {
+        if (!runway.used) return request.time;
+        return std::max(request.time, runway.slot + separation(runway.operation, runway.wake,
+                                                               request.operation, request.wake));
+    }
+
+    // The runway where the request can start soonest, and when
+    std::pair<std::size_t, double> bestRunway(const Request& request) const {
+        std::size_t best = 0;
+        double bestStart = earliestStart(runways[0], request);
+        for (std::size_t i = 1; i < runways.size(); ++i) {
+            double start = earliestStart(runways[i], request);
+            if (start < bestStart) {
+                best = i;
+                bestStart = start;
+            }
+        }
+        return {best, bestStart};
+    }
+
+public:
+    explicit RunwayScheduler(int runwayCount) : runways(std::max(runwayCount, 1)) {}
+
+    // Seconds from the leader's slot to the follower's on the same runway
+    static double separation(RunwayOperation leader, WakeCategory leaderWake,
+                             RunwayOperation /*follower*/, WakeCategory followerWake) {
+        // Runway occupancy of the leader
+        double gap = leader == RunwayOperation::Landing ? 75.0 : 60.0;
+
+        // Extra wake turbulence spacing, [leader][follower]
+        static const double wake[3][3] = {
+            {0.0, 0.0, 0.0},     // behind Light
+            {30.0, 0.0, 0.0},    // behind Medium
+            {60.0, 30.0, 0.0},   // behind Heavy
+        };
+        return gap + wake[static_cast<int>(leaderWake)][static_cast<int>(followerWake)];
+    }
+
+    void request(Airplane* airplane, RunwayOperation operation, WakeCategory wake, bool emergency, double time) {
+        std::uint8_t priority = emergency ? 2 : operation == RunwayOperation::Landing ? 1 : 0;
+        pending.push(Request{airplane, operation, wake, priority, time, nextSequence++});
+    }
+
+    // Assigns every slot that can start by time, in order, and passes each one
+    // to onClearance. The tower decides at time, so no slot starts before it.
+    template <typename Callback>
+    void advanceTo(double time, Callback&& onClearance) {
+        while (!pending.empty()) {
+            Request next = pending.top();
+            auto [best, bestStart] = bestRunway(next);
+            if (bestStart > time) break;
+
+            pending.pop();
+            double slot = std::max(time, bestStart);
+            Runway& runway = runways[best];
+            runway.used = true;
+            runway.operation = next.operation;
+            runway.wake = next.wake;
+            runway.slot = slot;
+            onClearance(Clearance{next.airplane, next.operation, next.wake, static_cast<int>(best), next.time, slot});
+        }
+    }
+
+    // When the next waiting request could start, or infinity if none waits
+    double nextSlot() const {
+        if (pending.empty()) return std::numeric_limits<double>::infinity();
+        return bestRunway(pending.top()).second;
+    }
+
+    std::size_t pendingCount() const { return pending.size(); }
+    int runwayCount() const { return static_cast<int>(runways.size()); }
+
+    // Pairs of operations closer than their separation on one runway, plus
+    // slots before their request. Zero for any log this scheduler produced.
+    static std::size_t countConflicts(std::vector<Clearance> log) {
+        std::sort(log.begin(), log.end(), [](const Clearance& a, const Clearance& b) {
+            return a.runway != b.runway ? a.runway < b.runway : a.slot < b.slot;
+        });
+        std::size_t conflicts = 0;
+        for (std::size_t i = 0; i < log.size(); ++i) {
+            if (log[i].slot < log[i].requestedAt) ++conflicts;
+            if (i == 0 || log[i - 1].runway != log[i].runway) continue;
+            const Clearance& leader = log[i - 1];
+            double required = separation(leader.operation, leader.wake, log[i].operation, log[i].wake);
+            if (log[i].slot - leader.slot < required - 1e-9) ++conflicts;
+        }
+        return conflicts;
+    }
+};
+
 // Concrete Mediator
 class AirportControlTower : public AirTrafficControlTower {
+private:
+    RunwayScheduler scheduler;
+    double now = 0;
+    std::vector<Clearance> clearances;
+
 public:
+    explicit AirportControlTower(int runways = 1) : scheduler(runways) {}
+
     void requestTakeoff(Airplane* airplane) override {
         airplane->notifyAirTrafficControl("Requesting takeoff clearance.");
+        scheduler.request(airplane, RunwayOperation::Takeoff, airplane->getWakeCategory(), airplane->isEmergency(), now);
     }
 
     void requestLanding(Airplane* airplane) override {
         airplane->notifyAirTrafficControl("Requesting landing clearance.");
+        scheduler.request(airplane, RunwayOperation::Landing, airplane->getWakeCategory(), airplane->isEmergency(), now);
+    }
+
+    // Moves tower time forward and clears every slot that is due
+    void advanceTo(double time) {
+        now = std::max(now, time);
+        scheduler.advanceTo(now, [this](const Clearance& clearance) {
+            clearances.push_back(clearance);
+            clearance.airplane->clearedFor(clearance);
+        });
+    }
+
+    double currentTime() const { return now; }
+    double nextSlot() const { return scheduler.nextSlot(); }
+    std::size_t waitingCount() const { return scheduler.pendingCount(); }
+    const std::vector<Clearance>& getClearances() const { return clearances; }
+};
+
+// Mailbox
+// Bounded lock-free queue for many senders and one receiver. Every cell has a
+// sequence number saying whether it is free for position p (== p) or holds the
+// message for p (== p + 1). The buffer is allocated once.
+class Mailbox {
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        Message message;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    std::size_t mask;
+    alignas(64) std::atomic<std::size_t> tail{0};   // next position to post
+    alignas(64) std::size_t head = 0;               // next position to read, receiver only
+
+public:
+    // Capacity is rounded up to a power of two
+    explicit Mailbox(std::size_t capacity) {
+        std::size_t size = 2;
+        while (size < capacity) size *= 2;
+        cells.reset(new Cell[size]);
+        mask = size - 1;
+        for (std::size_t i = 0; i < size; ++i) cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    // Any thread. Returns false when the mailbox is full.
+    bool post(const Message& message) {
+        std::size_t position = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[position & mask];
+            std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.message = message;
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Receiver only. Copies up to max messages into out.
+    std::size_t drain(Message* out, std::size_t max) {
+        std::size_t count = 0;
+        while (count < max) {
+            Cell& cell = cells[head & mask];
+            if (cell.sequence.load(std::memory_order_acquire) != head + 1) break;
+            out[count++] = cell.message;
+            cell.sequence.store(head + mask + 1, std::memory_order_release);
+            ++head;
+        }
+        return count;
+    }
+};
+
+// Mailbox Mediator
+// Register airplanes and intern texts first; after that send() may be called
+// from any thread and deliver() from one thread at a time.
+class MailboxControlTower : public AirTrafficControlTower {
+private:
+    static constexpr std::size_t kBatch = 64;
+
+    MessageCatalog catalog;
+    std::size_t mailboxCapacity;
+    std::vector<Airplane*> airplanes;
+    std::vector<std::unique_ptr<Mailbox>> mailboxes;
+    std::unordered_map<const Airplane*, std::size_t> addresses;
+    std::uint32_t takeoffRequested;
+    std::uint32_t landingRequested;
+    std::atomic<std::uint64_t> dropped{0};
+
+public:
+    explicit MailboxControlTower(std::size_t mailboxCapacity = 1024)
+        : mailboxCapacity(mailboxCapacity),
+          takeoffRequested(catalog.intern("Requesting takeoff clearance.")),
+          landingRequested(catalog.intern("Requesting landing clearance.")) {}
+
+    // Returns the airplane's address for send()
+    std::size_t registerAirplane(Airplane* airplane) {
+        auto it = addresses.find(airplane);
+        if (it != addresses.end()) return it->second;
+        airplanes.push_back(airplane);
+        mailboxes.push_back(std::make_unique<Mailbox>(mailboxCapacity));
+        return addresses[airplane] = airplanes.size() - 1;
+    }
+
+    MessageCatalog& getCatalog() { return catalog; }
+
+    // False, and counted as dropped, when the mailbox is full
+    bool send(std::size_t address, const Message& message) {
+        if (mailboxes[address]->post(message)) return true;
+        ++dropped;
+        return false;
+    }
+
+    bool send(const Airplane* airplane, const Message& message) {
+        return send(addresses.at(airplane), message);
+    }
+
+    void requestTakeoff(Airplane* airplane) override {
+        send(airplane, Message{takeoffRequested, 0, 0.0, nullptr});
     }
+
+    void requestLanding(Airplane* airplane) override {
+        send(airplane, Message{landingRequested, 0, 0.0, nullptr});
+    }
+
+    // Hands every waiting message to its airplane, kBatch at a time.
+    // Returns how many were delivered.
+    std::size_t deliver() {
+        Message batch[kBatch];
+        std::size_t delivered = 0;
+        for (std::size_t i = 0; i < mailboxes.size(); ++i) {
+            std::size_t count;
+            while ((count = mailboxes[i]->drain(batch, kBatch)) > 0) {
+                airplanes[i]->receive(batch, count, catalog);
+                delivered += count;
+            }
+        }
+        return delivered;
+    }
+
+    std::uint64_t droppedCount() const { return dropped; }
 };
 
 // Concrete Colleague
@@ -70,7 +438,213 @@ public:
     }
 };
 
-int main() {
+// Simulator
+// Records its slot instead of printing
+class SimulatedAirplane : public Airplane {
+private:
+    AirTrafficControlTower* mediator;
+    WakeCategory wake;
+    bool emergency;
+
+public:
+    double delay = -1;   // slot minus request time, once cleared
+
+    SimulatedAirplane(AirTrafficControlTower* mediator, WakeCategory wake, bool emergency)
+        : mediator(mediator), wake(wake), emergency(emergency) {}
+
+    void requestTakeoff() override { mediator->requestTakeoff(this); }
+    void requestLanding() override { mediator->requestLanding(this); }
+    void notifyAirTrafficControl(const std::string& /*message*/) override {}
+
+    WakeCategory getWakeCategory() const override { return wake; }
+    bool isEmergency() const override { return emergency; }
+
+    void clearedFor(const Clearance& clearance) override {
+        delay = clearance.slot - clearance.requestedAt;
+    }
+};
+
+using Clock = std::chrono::steady_clock;
+
+double percentile(std::vector<double>& values, double p) {
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<std::size_t>(p * values.size()))];
+}
+
+// Hub traffic: a 15 minute bank every hour at 2.5x the mean rate, 0.5x in
+// between. The mean is 85% of runway capacity, so queues build in every bank
+// and drain afterwards.
+void runSimulation(int airplanes, int runways) {
+    struct Arrival {
+        double time;
+        RunwayOperation operation;
+    };
+
+    std::mt19937 random(2024);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    const double capacity = runways / 80.0;   // operations per second, with typical spacing
+    const double meanRate = 0.85 * capacity;
+
+    AirportControlTower tower(runways);
+    std::vector<std::unique_ptr<SimulatedAirplane>> fleet;
+    std::vector<Arrival> arrivals;
+    double time = 0;
+    for (int i = 0; i < airplanes; ++i) {
+        bool inBank = std::fmod(time, 3600.0) < 900.0;
+        double rate = meanRate * (inBank ? 2.5 : 0.5);
+        time += -std::log(1.0 - unit(random)) / rate;
+
+        double kind = unit(random);
+        WakeCategory wake = kind < 0.1 ? WakeCategory::Heavy : kind < 0.8 ? WakeCategory::Medium : WakeCategory::Light;
+        fleet.push_back(std::make_unique<SimulatedAirplane>(&tower, wake, unit(random) < 0.001));
+        arrivals.push_back({time, unit(random) < 0.5 ? RunwayOperation::Takeoff : RunwayOperation::Landing});
+    }
+
+    std::cout << "Simulation: " << airplanes << " airplanes, " << runways << " runways, "
+              << time / 3600.0 << " simulated hours\n";
+
+    // The tower wakes up for every slot, not just for every arrival
+    auto advance = [&tower](double until) {
+        for (double next = tower.nextSlot(); next <= until; next = tower.nextSlot()) tower.advanceTo(next);
+        tower.advanceTo(until);
+    };
+
+    std::vector<double> latencies;
+    latencies.reserve(airplanes);
+    std::size_t maxWaiting = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < airplanes; ++i) {
+        auto begin = Clock::now();
+        advance(arrivals[i].time);
+        if (arrivals[i].operation == RunwayOperation::Takeoff) fleet[i]->requestTakeoff();
+        else fleet[i]->requestLanding();
+        latencies.push_back(std::chrono::duration<double, std::nano>(Clock::now() - begin).count());
+        maxWaiting = std::max(maxWaiting, tower.waitingCount());
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    while (tower.waitingCount() > 0) tower.advanceTo(tower.nextSlot());
+
+    std::vector<double> delays;
+    for (const auto& airplane : fleet) delays.push_back(airplane->delay);
+
+    std::cout << "  scheduling: " << airplanes / seconds / 1e6 << " M requests/s, p50 "
+              << percentile(latencies, 0.50) << " ns, p99 " << percentile(latencies, 0.99) << " ns per request\n"
+              << "  queue: at most " << maxWaiting << " waiting; delay p50 " << percentile(delays, 0.50)
+              << " s, p99 " << percentile(delays, 0.99) << " s\n"
+              << "  cleared " << tower.getClearances().size() << ", conflicts "
+              << RunwayScheduler::countConflicts(tower.getClearances()) << "\n";
+}
+
+// Mailbox benchmark
+// Producer threads send clearances to many airplanes while the main thread
+// delivers. The baseline builds a std::string per message and queues it under
+// a lock, as notifyAirTrafficControl callers had to.
+class CountingAirplane : public Airplane {
+public:
+    std::uint64_t received = 0;
+    std::uint64_t checksum = 0;
+
+    void requestTakeoff() override {}
+    void requestLanding() override {}
+
+    void notifyAirTrafficControl(const std::string& message) override {
+        ++received;
+        checksum += message.back() - '0';   // the runway digit
+    }
+
+    void receive(const Message* messages, std::size_t count, const MessageCatalog& /*catalog*/) override {
+        received += count;
+        for (std::size_t i = 0; i < count; ++i) checksum += messages[i].argument;
+    }
+};
+
+class StringQueue {
+private:
+    std::mutex mutex;
+    std::deque<std::string> messages;
+
+public:
+    void post(std::string message) {
+        std::lock_guard<std::mutex> lock(mutex);
+        messages.push_back(std::move(message));
+    }
+
+    std::size_t deliver(Airplane& airplane) {
+        std::deque<std::string> taken;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            taken.swap(messages);
+        }
+        for (const auto& message : taken) airplane.notifyAirTrafficControl(message);
+        return taken.size();
+    }
+};
+
+void runMailboxBenchmark(std::size_t messages, std::size_t colleagues, std::size_t producers) {
+    std::cout << "Mailbox benchmark: " << messages << " messages, " << colleagues << " airplanes, "
+              << producers << " producer threads\n";
+    auto targetOf = [colleagues](std::size_t i) { return (i * 7919) % colleagues; };
+    auto runwayOf = [](std::size_t i) { return static_cast<int>(i % 4) + 1; };
+
+    auto measure = [&](const char* name, auto&& post, auto&& deliverAll, std::vector<CountingAirplane>& fleet) {
+        auto start = Clock::now();
+        std::vector<std::thread> threads;
+        for (std::size_t p = 0; p < producers; ++p) {
+            threads.emplace_back([&, p] {
+                for (std::size_t i = p; i < messages; i += producers) post(i);
+            });
+        }
+        std::size_t delivered = 0;
+        while (delivered < messages) {
+            std::size_t count = deliverAll();
+            if (count == 0) std::this_thread::yield();
+            delivered += count;
+        }
+        for (auto& thread : threads) thread.join();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::uint64_t checksum = 0;
+        for (const auto& airplane : fleet) checksum += airplane.checksum;
+        std::cout << "  " << name << messages / seconds / 1e6 << " M messages/s, checksum " << checksum << "\n";
+    };
+
+    {
+        std::vector<CountingAirplane> fleet(colleagues);
+        std::vector<StringQueue> queues(colleagues);
+        measure("strings + locks: ",
+                [&](std::size_t i) {
+                    queues[targetOf(i)].post("Cleared for takeoff on runway " + std::to_string(runwayOf(i)));
+                },
+                [&] {
+                    std::size_t count = 0;
+                    for (std::size_t c = 0; c < colleagues; ++c) count += queues[c].deliver(fleet[c]);
+                    return count;
+                },
+                fleet);
+    }
+
+    {
+        std::vector<CountingAirplane> fleet(colleagues);
+        MailboxControlTower tower(256);
+        for (auto& airplane : fleet) tower.registerAirplane(&airplane);
+        std::uint32_t cleared = tower.getCatalog().intern("Cleared for takeoff on runway");
+        measure("mailboxes:       ",
+                [&](std::size_t i) {
+                    Message message{cleared, runwayOf(i), 0.0, nullptr};
+                    while (!tower.send(targetOf(i), message)) std::this_thread::yield();
+                },
+                [&] { return tower.deliver(); },
+                fleet);
+    }
+}
+
+// Usage: mediator [--bench [airplanes] [runways]]
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        runSimulation(argc > 2 ? std::atoi(argv[2]) : 200000, argc > 3 ? std::atoi(argv[3]) : 4);
+        runMailboxBenchmark(4000000, 10000, 2);
+        return 0;
+    }
+
     auto tower = std::make_unique<AirportControlTower>();
     auto airplane1 = std::make_unique<CommercialAirplane>(tower.get());
     auto airplane2 = std::make_unique<CommercialAirplane>(tower.get());
@@ -78,5 +652,17 @@ int main() {
     airplane1->requestTakeoff();
     airplane2->requestLanding();
 
+    // Landings go first; the takeoff waits out the landing's runway time
+    while (tower->waitingCount() > 0) tower->advanceTo(tower->nextSlot());
+
+    // The same requests through mailboxes, delivered in one batch per airplane
+    MailboxControlTower mailboxTower;
+    CommercialAirplane airplane3(&mailboxTower);
+    mailboxTower.registerAirplane(&airplane3);
+    std::uint32_t holdShort = mailboxTower.getCatalog().intern("Hold short of runway 1.");
+    airplane3.requestTakeoff();
+    mailboxTower.send(&airplane3, Message{holdShort, 1, 0.0, nullptr});
+    mailboxTower.deliver();
+
     return 0;
 }
@@ -6,12 +6,56 @@ Suppose we have to represent two states by the use of memento patterns then
 we can use three classes to represent this Originator class to store the 
 data then memento patterns for storing the state of originator then 
 caretaker will hold the memento to solve the problem.
+
+--- Delta mementos ---
+A Caretaker keeps a full copy of the state in every memento, which costs
+O(size x versions). A DeltaCaretaker stores only the edit from the previous
+version (common prefix and suffix trimmed away), with a full keyframe every
+few versions or whenever the edit inserts at least half of the new state, when
+a delta would save little. Restoring a version copies the nearest keyframe at
+or before it and replays the deltas after it, so it costs one copy plus at most
+keyframeInterval - 1 edits.
+
+--- Persistent history ---
+A PersistentCaretaker appends every memento to a log file mapped into memory
+and keeps an in-memory index of record offsets. GetMemento(index) returns a
+MementoView that points straight into the mapping, so it is O(1) and copies
+nothing. Records can optionally be compressed (a small LZ77 scheme). Those are
+decompressed on first access and then cached. Every record carries a checksum.
+On open the log is scanned, and a torn or corrupt tail left by a crash is cut
+off at the last complete record; a file whose header never reached the disk is
+read as a log without one. The address range for the mapping is reserved up
+front, so growing the file never moves it and views stay valid.
+
+--- Persistent state ---
+A RopeOriginator keeps its text in a Rope: an immutable, height-balanced tree
+of text chunks shared between versions. An edit builds new nodes only along
+the paths it touches, O(log n) of them, and shares the rest. CreateMemento and
+RestoreState then just copy the root pointer, which is O(1) however large the
+buffer is.
 */
 
 #include <iostream>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <random>
 #include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // Originator: The object whose state needs to be saved and restored.
 class Originator {
@@ -33,10 +77,10 @@ public:
         std::string savedState;
 
     public:
-        explicit Memento(const std::string& originatorState)
-            : savedState(originatorState) {}
+        explicit Memento(std::string originatorState)
+            : savedState(std::move(originatorState)) {}
 
-        std::string GetSavedState() const {
+        const std::string& GetSavedState() const {
             return savedState;
         }
     };
@@ -46,31 +90,818 @@ public:
         return Memento(state);
     }
 
+    // Read-only view of a saved state that lives elsewhere, e.g. in a mapped file
+    class MementoView {
+    private:
+        std::string_view savedState;
+
+    public:
+        explicit MementoView(std::string_view originatorState)
+            : savedState(originatorState) {}
+
+        std::string_view GetSavedState() const {
+            return savedState;
+        }
+    };
+
     // Restore state from a Memento
     void RestoreState(const Memento& memento) {
         state = memento.GetSavedState();
     }
+
+    void RestoreState(const MementoView& memento) {
+        state.assign(memento.GetSavedState());
+    }
+};
+
+// Rope: Immutable text, shared structurally between versions
+// Leaves hold up to kMaxLeaf characters; inner nodes keep the AVL height rule
+// so every edit is O(log n) plus the size of one leaf.
+class Rope {
+private:
+    static constexpr std::size_t kMaxLeaf = 512;
+
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    struct Node {
+        NodePtr left, right;   // both null for a leaf
+        std::string text;      // leaf only
+        std::size_t length;
+        int height;
+    };
+
+    NodePtr root;
+
+    explicit Rope(NodePtr root) : root(std::move(root)) {}
+
+    static int Height(const NodePtr& node) { return node ? node->height : 0; }
+    static std::size_t Length(const NodePtr& node) { return node ? node->length : 0; }
+
+    static NodePtr Leaf(std::string text) {
+        if (text.empty()) return nullptr;
+        std::size_t length = text.size();
+        return std::make_shared<const Node>(Node{nullptr, nullptr, std::move(text), length, 1});
+    }
+
+    static NodePtr Inner(NodePtr left, NodePtr right) {
+        std::size_t length = left->length + right->length;
+        int height = 1 + std::max(left->height, right->height);
+        return std::make_shared<const Node>(Node{std::move(left), std::move(right), {}, length, height});
+    }
+
+    // Inner node with at most one rotation; the heights may differ by two
+    static NodePtr Balance(NodePtr left, NodePtr right) {
+        if (Height(left) > Height(right) + 1) {
+            if (Height(left->left) >= Height(left->right)) return Inner(left->left, Inner(left->right, std::move(right)));
+            return Inner(Inner(left->left, left->right->left), Inner(left->right->right, std::move(right)));
+        }
+        if (Height(right) > Height(left) + 1) {
+            if (Height(right->right) >= Height(right->left)) return Inner(Inner(std::move(left), right->left), right->right);
+            return Inner(Inner(std::move(left), right->left->left), Inner(right->left->right, right->right));
+        }
+        return Inner(std::move(left), std::move(right));
+    }
+
+    // Concatenation; walks down the taller side, O(height difference)
+    static NodePtr Join(NodePtr left, NodePtr right) {
+        if (!left) return right;
+        if (!right) return left;
+        if (left->height == 1 && right->height == 1 && left->length + right->length <= kMaxLeaf) {
+            return Leaf(left->text + right->text);   // keeps keystroke edits from fragmenting leaves
+        }
+        if (left->height > right->height + 1) return Balance(left->left, Join(left->right, std::move(right)));
+        if (right->height > left->height + 1) return Balance(Join(std::move(left), right->left), right->right);
+        return Inner(std::move(left), std::move(right));
+    }
+
+    // First position characters and the rest
+    static std::pair<NodePtr, NodePtr> Split(const NodePtr& node, std::size_t position) {
+        if (!node) return {nullptr, nullptr};
+        if (position == 0) return {nullptr, node};
+        if (position >= node->length) return {node, nullptr};
+        if (node->height == 1) return {Leaf(node->text.substr(0, position)), Leaf(node->text.substr(position))};
+        if (position < node->left->length) {
+            auto parts = Split(node->left, position);
+            return {parts.first, Join(parts.second, node->right)};
+        }
+        auto parts = Split(node->right, position - node->left->length);
+        return {Join(node->left, parts.first), parts.second};
+    }
+
+    static NodePtr Build(const std::string& text, std::size_t begin, std::size_t end) {
+        if (end - begin <= kMaxLeaf) return Leaf(text.substr(begin, end - begin));
+        std::size_t chunks = (end - begin + kMaxLeaf - 1) / kMaxLeaf;
+        std::size_t middle = begin + chunks / 2 * kMaxLeaf;
+        return Inner(Build(text, begin, middle), Build(text, middle, end));
+    }
+
+    static void Append(const NodePtr& node, std::size_t begin, std::size_t end, std::string& out) {
+        if (!node || begin >= end) return;
+        if (node->height == 1) {
+            out.append(node->text, begin, end - begin);
+            return;
+        }
+        std::size_t leftLength = node->left->length;
+        if (begin < leftLength) Append(node->left, begin, std::min(end, leftLength), out);
+        if (end > leftLength) Append(node->right, begin > leftLength ? begin - leftLength : 0, end - leftLength, out);
+    }
+
+public:
+    Rope() = default;
+    explicit Rope(const std::string& text) : root(text.empty() ? nullptr : Build(text, 0, text.size())) {}
+
+    std::size_t Length() const { return Length(root); }
+
+    Rope Insert(std::size_t position, const std::string& text) const {
+        if (text.empty()) return *this;
+        auto parts = Split(root, std::min(position, Length()));
+        // A long paste is split into leaves too, so later edits inside it stay O(log n)
+        return Rope(Join(Join(parts.first, Build(text, 0, text.size())), parts.second));
+    }
+
+    Rope Erase(std::size_t position, std::size_t count) const {
+        position = std::min(position, Length());
+        auto head = Split(root, position);
+        auto tail = Split(head.second, std::min(count, Length() - position));
+        return Rope(Join(head.first, tail.second));
+    }
+
+    std::string Substring(std::size_t position, std::size_t count) const {
+        std::string out;
+        position = std::min(position, Length());
+        count = std::min(count, Length() - position);
+        out.reserve(count);
+        Append(root, position, position + count, out);
+        return out;
+    }
+
+    std::string ToString() const {
+        return Substring(0, Length());
+    }
+
+    // Bytes of the nodes not in counted yet; adds them to counted
+    std::size_t MemoryBytes(std::unordered_set<const void*>& counted) const {
+        std::size_t bytes = 0;
+        std::vector<const Node*> stack;
+        if (root) stack.push_back(root.get());
+        while (!stack.empty()) {
+            const Node* node = stack.back();
+            stack.pop_back();
+            if (!counted.insert(node).second) continue;
+            bytes += sizeof(Node) + 16 + node->text.capacity();   // 16: shared_ptr control block
+            if (node->left) stack.push_back(node->left.get());
+            if (node->right) stack.push_back(node->right.get());
+        }
+        return bytes;
+    }
+};
+
+// Rope Originator: Same roles as Originator, with O(1) snapshots
+class RopeOriginator {
+private:
+    Rope state;
+
+public:
+    void SetState(const std::string& newState) {
+        state = Rope(newState);
+    }
+
+    std::string GetState() const {
+        return state.ToString();
+    }
+
+    void Insert(std::size_t position, const std::string& text) {
+        state = state.Insert(position, text);
+    }
+
+    void Erase(std::size_t position, std::size_t count) {
+        state = state.Erase(position, count);
+    }
+
+    std::size_t Length() const {
+        return state.Length();
+    }
+
+    // Memento: Shares the rope of the moment it was taken
+    class Memento {
+    private:
+        Rope savedState;
+
+    public:
+        explicit Memento(Rope originatorState)
+            : savedState(std::move(originatorState)) {}
+
+        const Rope& GetSavedState() const {
+            return savedState;
+        }
+    };
+
+    Memento CreateMemento() const {
+        return Memento(state);
+    }
+
+    void RestoreState(const Memento& memento) {
+        state = memento.GetSavedState();
+    }
 };
 
 // Caretaker: Stores and manages Mementos
-class Caretaker {
+template <typename MementoType>
+class BasicCaretaker {
 private:
-    std::vector<Originator::Memento> mementos;
+    std::vector<MementoType> mementos;
 
 public:
-    void AddMemento(Originator::Memento memento) {
+    void AddMemento(MementoType memento) {
         mementos.push_back(std::move(memento));
     }
 
-    const Originator::Memento& GetMemento(std::size_t index) const {
+    const MementoType& GetMemento(std::size_t index) const {
         if (index < mementos.size()) {
             return mementos[index];
         }
         throw std::out_of_range("Invalid Memento index");
     }
+
+    std::size_t Size() const {
+        return mementos.size();
+    }
 };
 
-int main() {
+using Caretaker = BasicCaretaker<Originator::Memento>;
+
+// Delta Caretaker: Stores each Memento as an edit against the previous one
+class DeltaCaretaker {
+private:
+    // state = previous.replace(offset, erased, text), or state = text for a keyframe
+    struct Entry {
+        bool keyframe;
+        std::size_t offset;
+        std::size_t erased;
+        std::string text;
+    };
+
+    std::size_t keyframeInterval;
+    std::vector<Entry> entries;
+    std::vector<std::size_t> keyframes;   // indices of keyframe entries, ascending
+    std::string latest;                   // state of the last memento, to diff against
+
+public:
+    explicit DeltaCaretaker(std::size_t keyframeInterval = 32)
+        : keyframeInterval(std::max<std::size_t>(keyframeInterval, 1)) {}
+
+    void AddMemento(const Originator::Memento& memento) {
+        const std::string& state = memento.GetSavedState();
+        std::size_t index = entries.size();
+
+        std::size_t limit = std::min(latest.size(), state.size());
+        std::size_t prefix = 0;
+        while (prefix < limit && latest[prefix] == state[prefix]) ++prefix;
+        std::size_t suffix = 0;
+        while (suffix < limit - prefix && latest[latest.size() - 1 - suffix] == state[state.size() - 1 - suffix]) {
+            ++suffix;
+        }
+        std::size_t inserted = state.size() - prefix - suffix;
+
+        // Keyframe when a delta would hold half the new state or more
+        if (index % keyframeInterval == 0 || inserted >= state.size() / 2) {
+            entries.push_back(Entry{true, 0, 0, state});
+            keyframes.push_back(index);
+        } else {
+            entries.push_back(Entry{false, prefix, latest.size() - prefix - suffix, state.substr(prefix, inserted)});
+        }
+        latest = state;
+    }
+
+    Originator::Memento GetMemento(std::size_t index) const {
+        if (index >= entries.size()) {
+            throw std::out_of_range("Invalid Memento index");
+        }
+        // Nearest keyframe at or before index; entry 0 is always one
+        std::size_t start = *(std::upper_bound(keyframes.begin(), keyframes.end(), index) - 1);
+        std::string state = entries[start].text;
+        for (std::size_t i = start + 1; i <= index; ++i) {
+            const Entry& delta = entries[i];
+            state.replace(delta.offset, delta.erased, delta.text);
+        }
+        return Originator::Memento(std::move(state));
+    }
+
+    std::size_t Size() const {
+        return entries.size();
+    }
+
+    // Bytes held by the stored versions
+    std::size_t MemoryBytes() const {
+        std::size_t bytes = entries.capacity() * sizeof(Entry) + keyframes.capacity() * sizeof(std::size_t);
+        for (const Entry& entry : entries) bytes += entry.text.capacity();
+        return bytes + latest.capacity();
+    }
+};
+
+// Block compression
+// LZ77 with a 4-byte hash. The output is a list of sequences: varint literal
+// count, the literals, varint match offset (0 ends the block), varint match
+// length minus 4.
+class BlockCompressor {
+private:
+    static void PutVarint(std::string& out, std::uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    static std::uint64_t GetVarint(const unsigned char*& in, const unsigned char* end) {
+        std::uint64_t value = 0;
+        for (int shift = 0; in < end && shift < 64; shift += 7) {
+            unsigned char byte = *in++;
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        throw std::runtime_error("Corrupt compressed block");
+    }
+
+public:
+    static std::string Compress(std::string_view input) {
+        static constexpr int kHashBits = 14;
+        std::vector<std::uint32_t> table(1u << kHashBits, 0);   // position + 1, 0 = empty
+        const char* data = input.data();
+        std::size_t size = input.size();
+
+        std::string out;
+        out.reserve(size / 2 + 16);
+        std::size_t literalStart = 0;
+        std::size_t pos = 0;
+        while (pos + 4 <= size) {
+            std::uint32_t word;
+            std::memcpy(&word, data + pos, 4);
+            std::uint32_t& slot = table[(word * 2654435761u) >> (32 - kHashBits)];
+            std::size_t candidate = slot;
+            slot = static_cast<std::uint32_t>(pos + 1);
+            if (candidate == 0 || std::memcmp(data + candidate - 1, data + pos, 4) != 0) {
+                ++pos;
+                continue;
+            }
+            std::size_t from = candidate - 1;
+            std::size_t length = 4;
+            while (pos + length < size && data[from + length] == data[pos + length]) ++length;
+
+            PutVarint(out, pos - literalStart);
+            out.append(data + literalStart, pos - literalStart);
+            PutVarint(out, pos - from);
+            PutVarint(out, length - 4);
+            pos += length;
+            literalStart = pos;
+        }
+        PutVarint(out, size - literalStart);
+        out.append(data + literalStart, size - literalStart);
+        PutVarint(out, 0);
+        return out;
+    }
+
+    static std::string Decompress(std::string_view input, std::size_t rawSize) {
+        std::string out;
+        out.reserve(rawSize);
+        auto in = reinterpret_cast<const unsigned char*>(input.data());
+        auto end = in + input.size();
+        for (;;) {
+            std::uint64_t literals = GetVarint(in, end);
+            if (literals > static_cast<std::uint64_t>(end - in)) throw std::runtime_error("Corrupt compressed block");
+            out.append(reinterpret_cast<const char*>(in), literals);
+            in += literals;
+            std::uint64_t offset = GetVarint(in, end);
+            if (offset == 0) break;
+            std::uint64_t length = GetVarint(in, end) + 4;
+            if (offset > out.size()) throw std::runtime_error("Corrupt compressed block");
+            for (std::size_t from = out.size() - offset; length > 0; --length) out.push_back(out[from++]);
+        }
+        if (out.size() != rawSize) throw std::runtime_error("Corrupt compressed block");
+        return out;
+    }
+};
+
+struct PersistentCaretakerOptions {
+    bool compress = false;              // store records LZ77-compressed when that is smaller
+    bool syncEachAppend = false;        // msync after every record instead of on Sync() and close
+    std::size_t maxBytes = 64ull << 30; // address space reserved for the file
+};
+
+// Persistent Caretaker: Appends Mementos to a memory-mapped log file
+// Layout: a 16-byte file header, then 8-byte aligned records, each a
+// RecordHeader followed by its payload. Not thread-safe.
+class PersistentCaretaker {
+private:
+    static constexpr char kFileMagic[8] = {'M', 'E', 'M', 'E', 'N', 'T', 'O', '1'};
+    static constexpr std::uint32_t kRecordMagic = 0x4d454d52;   // "RMEM"
+    static constexpr std::uint32_t kCompressed = 1;
+    static constexpr std::size_t kFileHeaderSize = 16;
+
+    struct RecordHeader {
+        std::uint32_t magic;
+        std::uint32_t flags;
+        std::uint64_t rawSize;
+        std::uint64_t storedSize;
+        std::uint64_t checksum;   // over flags, sizes and payload
+    };
+
+    PersistentCaretakerOptions options;
+    int fd = -1;
+    char* base = nullptr;        // start of the reserved range; the file is mapped at its start
+    std::size_t capacity = 0;    // bytes of the file currently mapped
+    std::size_t end = 0;         // end of the last complete record
+    std::size_t recovered = 0;   // bytes cut off a damaged tail when opening
+    std::vector<std::uint64_t> offsets;
+    mutable std::vector<std::unique_ptr<std::string>> decompressed;
+
+    [[noreturn]] static void Fail(const std::string& what) {
+        throw std::runtime_error(what + ": " + std::strerror(errno));
+    }
+
+    static std::size_t Align(std::size_t n) {
+        return (n + 7) & ~std::size_t{7};
+    }
+
+    // FNV-style, but 8 bytes per step so reopening a large log stays fast
+    static std::uint64_t Checksum(const RecordHeader& header, const char* payload) {
+        std::uint64_t hash = 1469598103934665603ull;
+        auto mix = [&hash](std::uint64_t word) {
+            hash = (hash ^ word) * 1099511628211ull;
+            hash ^= hash >> 29;
+        };
+        mix(header.flags);
+        mix(header.rawSize);
+        mix(header.storedSize);
+        std::size_t i = 0;
+        for (; i + 8 <= header.storedSize; i += 8) {
+            std::uint64_t word;
+            std::memcpy(&word, payload + i, 8);
+            mix(word);
+        }
+        for (; i < header.storedSize; ++i) mix(static_cast<unsigned char>(payload[i]) | 0x100u);
+        return hash;
+    }
+
+    // Maps the first newCapacity bytes of the file over the reservation
+    void MapFile(std::size_t newCapacity) {
+        if (newCapacity > options.maxBytes) throw std::length_error("Memento log exceeds its reserved size");
+        if (::ftruncate(fd, static_cast<off_t>(newCapacity)) != 0) Fail("ftruncate");
+        void* mapped = ::mmap(base, newCapacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+        if (mapped == MAP_FAILED) Fail("mmap");
+        capacity = newCapacity;
+    }
+
+    // Indexes every complete record and drops whatever follows the last one
+    void Recover(std::size_t fileSize) {
+        // A new file is grown before its header is written, so a crash before
+        // the first sync leaves zeros where the header should be
+        std::size_t headerBytes = std::min(fileSize, kFileHeaderSize);
+        if (std::all_of(base, base + headerBytes, [](char c) { return c == 0; })) {
+            std::memcpy(base, kFileMagic, sizeof(kFileMagic));
+            fileSize = std::max(fileSize, kFileHeaderSize);
+        } else if (fileSize < kFileHeaderSize || std::memcmp(base, kFileMagic, sizeof(kFileMagic)) != 0) {
+            throw std::runtime_error("Not a memento log");
+        }
+        std::size_t offset = kFileHeaderSize;
+        while (offset + sizeof(RecordHeader) <= fileSize) {
+            RecordHeader header;
+            std::memcpy(&header, base + offset, sizeof(header));
+            if (header.magic != kRecordMagic || header.storedSize > fileSize - offset - sizeof(header)) break;
+            // GetMemento views an uncompressed payload as rawSize bytes
+            if (!(header.flags & kCompressed) && header.rawSize != header.storedSize) break;
+            if (Checksum(header, base + offset + sizeof(header)) != header.checksum) break;
+            offsets.push_back(offset);
+            offset += Align(sizeof(header) + header.storedSize);
+        }
+        end = std::min(offset, fileSize);
+        recovered = fileSize - end;
+        if (recovered > 0) {
+            // Zero the damaged tail so a later crash cannot revive stale records behind it
+            std::memset(base + end, 0, capacity - end);
+            if (::msync(base, capacity, MS_SYNC) != 0) Fail("msync");
+        }
+    }
+
+public:
+    explicit PersistentCaretaker(const std::string& path, PersistentCaretakerOptions options = {})
+        : options(options) {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) Fail("open " + path);
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            Fail("fstat " + path);
+        }
+        void* reserved = ::mmap(nullptr, options.maxBytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (reserved == MAP_FAILED) {
+            ::close(fd);
+            Fail("mmap reserve");
+        }
+        base = static_cast<char*>(reserved);
+        try {
+            std::size_t fileSize = static_cast<std::size_t>(info.st_size);
+            MapFile(std::max<std::size_t>(Align(fileSize), 1 << 16));
+            Recover(fileSize);
+            decompressed.resize(offsets.size());
+        } catch (...) {
+            ::munmap(base, options.maxBytes);
+            ::close(fd);
+            throw;
+        }
+    }
+
+    PersistentCaretaker(const PersistentCaretaker&) = delete;
+    PersistentCaretaker& operator=(const PersistentCaretaker&) = delete;
+
+    // Flushes and trims the file to its records
+    ~PersistentCaretaker() {
+        ::msync(base, capacity, MS_SYNC);
+        ::munmap(base, options.maxBytes);
+        if (::ftruncate(fd, static_cast<off_t>(end)) != 0) std::perror("ftruncate");
+        ::close(fd);
+    }
+
+    void AddMemento(const Originator::Memento& memento) {
+        const std::string& state = memento.GetSavedState();
+        std::string compressed;
+        RecordHeader header{kRecordMagic, 0, state.size(), state.size(), 0};
+        const char* payload = state.data();
+        if (options.compress) {
+            compressed = BlockCompressor::Compress(state);
+            if (compressed.size() < state.size()) {
+                header.flags = kCompressed;
+                header.storedSize = compressed.size();
+                payload = compressed.data();
+            }
+        }
+        header.checksum = Checksum(header, payload);
+
+        std::size_t recordSize = Align(sizeof(header) + header.storedSize);
+        if (end + recordSize > capacity) {
+            std::size_t newCapacity = capacity;
+            while (end + recordSize > newCapacity) newCapacity *= 2;
+            MapFile(newCapacity);
+        }
+        // A torn copy fails its checksum, so the write order does not matter
+        std::memcpy(base + end + sizeof(header), payload, header.storedSize);
+        std::memcpy(base + end, &header, sizeof(header));
+        if (options.syncEachAppend) {
+            std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+            std::size_t from = end / page * page;
+            if (::msync(base + from, end + recordSize - from, MS_SYNC) != 0) Fail("msync");
+        }
+        offsets.push_back(end);
+        decompressed.emplace_back();
+        end += recordSize;
+    }
+
+    // Valid as long as the caretaker is open
+    Originator::MementoView GetMemento(std::size_t index) const {
+        if (index >= offsets.size()) {
+            throw std::out_of_range("Invalid Memento index");
+        }
+        RecordHeader header;
+        std::memcpy(&header, base + offsets[index], sizeof(header));
+        const char* payload = base + offsets[index] + sizeof(header);
+        if (!(header.flags & kCompressed)) {
+            return Originator::MementoView(std::string_view(payload, header.rawSize));
+        }
+        if (!decompressed[index]) {
+            decompressed[index] = std::make_unique<std::string>(
+                BlockCompressor::Decompress(std::string_view(payload, header.storedSize), header.rawSize));
+        }
+        return Originator::MementoView(*decompressed[index]);
+    }
+
+    void Sync() {
+        if (::msync(base, capacity, MS_SYNC) != 0) Fail("msync");
+    }
+
+    std::size_t Size() const { return offsets.size(); }
+    std::size_t FileBytes() const { return end; }
+    std::size_t RecoveredBytes() const { return recovered; }
+};
+
+// Benchmark
+// A large document receives many small edits; every version is saved.
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void runBenchmark(std::size_t documentSize, std::size_t versions) {
+    std::cout << "Benchmark: " << documentSize / 1024 << " KiB document, " << versions << " versions\n";
+
+    std::mt19937 random(7);
+    std::vector<Originator::Memento> history;
+    {
+        std::string document(documentSize, ' ');
+        for (char& c : document) c = static_cast<char>('a' + random() % 26);
+        for (std::size_t v = 0; v < versions; ++v) {
+            // Replace, insert or delete a few dozen characters somewhere
+            std::size_t at = random() % document.size();
+            std::size_t erase = std::min<std::size_t>(random() % 40, document.size() - at);
+            std::string text(random() % 40, static_cast<char>('A' + v % 26));
+            document.replace(at, erase, text);
+            history.emplace_back(document);
+        }
+    }
+
+    std::size_t fullBytes = history.capacity() * sizeof(Originator::Memento);
+    for (const auto& memento : history) fullBytes += memento.GetSavedState().capacity();
+    std::cout << "  full copies:    " << fullBytes / 1048576.0 << " MiB\n";
+
+    std::vector<std::size_t> probes;
+    for (int i = 0; i < 200; ++i) probes.push_back(random() % versions);
+
+    for (std::size_t interval : {1, 8, 32, 128, 512}) {
+        DeltaCaretaker caretaker(interval);
+        auto start = Clock::now();
+        for (const auto& memento : history) caretaker.AddMemento(memento);
+        double addSeconds = secondsSince(start);
+
+        std::size_t mismatches = 0;
+        start = Clock::now();
+        for (std::size_t index : probes) {
+            mismatches += caretaker.GetMemento(index).GetSavedState() != history[index].GetSavedState();
+        }
+        double restoreSeconds = secondsSince(start);
+
+        std::cout << "  keyframe every " << interval << ": " << caretaker.MemoryBytes() / 1048576.0 << " MiB, add "
+                  << addSeconds / versions * 1e6 << " us, restore " << restoreSeconds / probes.size() * 1e6
+                  << " us" << (mismatches ? "  (MISMATCH)" : "") << "\n";
+    }
+
+    // Restore time grows with the distance from the keyframe
+    const std::size_t interval = 128;
+    DeltaCaretaker caretaker(interval);
+    for (const auto& memento : history) caretaker.AddMemento(memento);
+    std::cout << "  restore time by distance from keyframe (every " << interval << "):";
+    for (std::size_t distance : {0, 16, 32, 64, 127}) {
+        std::size_t count = 0;
+        auto start = Clock::now();
+        for (std::size_t base = 0; base + distance < versions; base += interval, ++count) {
+            caretaker.GetMemento(base + distance);
+        }
+        std::cout << " " << distance << ": " << secondsSince(start) / count * 1e6 << " us;";
+    }
+    std::cout << "\n";
+}
+
+// Writes a history to a log, reopens it, reads it back and damages its tail
+void runPersistentBenchmark(std::size_t versions) {
+    const std::string path = (std::filesystem::temp_directory_path() / "memento_benchmark.log").string();
+    std::cout << "Persistent benchmark: " << versions << " versions of a 64 KiB text document\n";
+
+    std::mt19937 random(11);
+    std::vector<std::string> words = {"memento ", "state ", "originator ", "caretaker ", "history ", "undo ", "redo "};
+    std::string document;
+    while (document.size() < (64u << 10)) document += words[random() % words.size()];
+    std::vector<Originator::Memento> history;
+    for (std::size_t v = 0; v < versions; ++v) {
+        document.replace(random() % document.size(), 8, words[random() % words.size()]);
+        history.emplace_back(document);
+    }
+
+    for (bool compress : {false, true}) {
+        std::filesystem::remove(path);
+        PersistentCaretakerOptions options;
+        options.compress = compress;
+
+        auto start = Clock::now();
+        std::size_t fileBytes;
+        {
+            PersistentCaretaker caretaker(path, options);
+            for (const auto& memento : history) caretaker.AddMemento(memento);
+            caretaker.Sync();
+            fileBytes = caretaker.FileBytes();
+        }
+        double writeSeconds = secondsSince(start);
+
+        start = Clock::now();
+        PersistentCaretaker reopened(path, options);
+        double openSeconds = secondsSince(start);
+
+        std::size_t mismatches = 0;
+        start = Clock::now();
+        for (std::size_t i = 0; i < versions; ++i) {
+            mismatches += reopened.GetMemento(i).GetSavedState() != history[i].GetSavedState();
+        }
+        double firstReadSeconds = secondsSince(start);
+        start = Clock::now();
+        std::size_t bytes = 0;
+        for (std::size_t i = 0; i < versions; ++i) bytes += reopened.GetMemento(i).GetSavedState().size();
+        double viewSeconds = secondsSince(start);
+
+        std::cout << "  " << (compress ? "compressed:  " : "plain:       ") << fileBytes / 1048576.0 << " MiB on disk, "
+                  << "append " << writeSeconds / versions * 1e6 << " us, reopen " << openSeconds * 1e3
+                  << " ms, first read " << firstReadSeconds / versions * 1e6 << " us, view "
+                  << viewSeconds / versions * 1e9 << " ns" << (mismatches || bytes == 0 ? "  (MISMATCH)" : "") << "\n";
+    }
+
+    // Crash in the middle of the last record: cut the file mid-payload
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 100);
+    PersistentCaretaker recovered(path);
+    std::cout << "  torn tail: " << recovered.Size() << " of " << versions << " records kept, "
+              << recovered.RecoveredBytes() << " bytes dropped\n";
+    std::filesystem::remove(path);
+}
+
+// An editing session on a large buffer with a snapshot after every keystroke
+void runRopeBenchmark(std::size_t bufferSize, std::size_t keystrokes) {
+    std::cout << "Rope benchmark: " << bufferSize / 1048576.0 << " MiB buffer, " << keystrokes
+              << " keystrokes, a snapshot after each\n";
+    std::mt19937 random(3);
+    std::string initial(bufferSize, ' ');
+    for (char& c : initial) c = static_cast<char>('a' + random() % 26);
+
+    // The cursor mostly moves a little; typing, with a backspace now and then
+    std::vector<std::pair<std::size_t, bool>> edits;   // position, true for insert
+    std::size_t cursor = bufferSize / 2;
+    std::size_t length = bufferSize;
+    for (std::size_t k = 0; k < keystrokes; ++k) {
+        if (random() % 50 == 0) cursor = random() % length;
+        bool insert = random() % 8 != 0 || cursor == 0;
+        if (insert) {
+            edits.emplace_back(cursor++, true);
+            ++length;
+        } else {
+            edits.emplace_back(--cursor, false);
+            --length;
+        }
+    }
+
+    // std::string state: every snapshot copies the whole buffer
+    {
+        std::size_t sample = std::min<std::size_t>(keystrokes, 100);
+        Originator originator;
+        originator.SetState(initial);
+        Caretaker caretaker;
+        std::string text = initial;
+        auto start = Clock::now();
+        for (std::size_t k = 0; k < sample; ++k) {
+            if (edits[k].second) text.insert(edits[k].first, 1, 'X');
+            else text.erase(edits[k].first, 1);
+            originator.SetState(text);
+            caretaker.AddMemento(originator.CreateMemento());
+        }
+        double seconds = secondsSince(start);
+        std::cout << "  std::string: " << seconds / sample * 1e6 << " us per keystroke, "
+                  << bufferSize / 1048576.0 * keystrokes << " MiB for all snapshots (measured on " << sample << ")\n";
+    }
+
+    RopeOriginator originator;
+    originator.SetState(initial);
+    BasicCaretaker<RopeOriginator::Memento> caretaker;
+    std::string reference = initial;
+    std::vector<std::pair<std::size_t, std::string>> checkpoints;
+    double editSeconds = 0;
+    double snapshotSeconds = 0;
+    for (std::size_t k = 0; k < keystrokes; ++k) {
+        auto start = Clock::now();
+        if (edits[k].second) originator.Insert(edits[k].first, "X");
+        else originator.Erase(edits[k].first, 1);
+        auto edited = Clock::now();
+        caretaker.AddMemento(originator.CreateMemento());
+        snapshotSeconds += secondsSince(edited);
+        editSeconds += std::chrono::duration<double>(edited - start).count();
+
+        if (edits[k].second) reference.insert(edits[k].first, 1, 'X');
+        else reference.erase(edits[k].first, 1);
+        if (k % (keystrokes / 8 + 1) == 0) checkpoints.emplace_back(k, reference);
+    }
+
+    std::unordered_set<const void*> counted;
+    std::size_t bytes = 0;
+    for (std::size_t k = 0; k < caretaker.Size(); ++k) bytes += caretaker.GetMemento(k).GetSavedState().MemoryBytes(counted);
+
+    std::size_t mismatches = 0;
+    auto start = Clock::now();
+    for (const auto& checkpoint : checkpoints) {
+        originator.RestoreState(caretaker.GetMemento(checkpoint.first));
+        mismatches += originator.GetState() != checkpoint.second;
+    }
+    double restoreSeconds = secondsSince(start);
+
+    std::cout << "  rope: edit " << editSeconds / keystrokes * 1e6 << " us, snapshot "
+              << snapshotSeconds / keystrokes * 1e9 << " ns per keystroke, " << bytes / 1048576.0
+              << " MiB for all snapshots\n"
+              << "  restore + read back whole buffer: " << restoreSeconds / checkpoints.size() * 1e3 << " ms"
+              << (mismatches ? "  (MISMATCH)" : "") << "\n";
+}
+
+// Usage: memento [--bench [document bytes] [versions]]
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        runBenchmark(argc > 2 ? std::atoi(argv[2]) : 256 << 10, argc > 3 ? std::atoi(argv[3]) : 2000);
+        runPersistentBenchmark(argc > 3 ? std::atoi(argv[3]) : 2000);
+        runRopeBenchmark(4 << 20, 20000);
+        return 0;
+    }
+
     Originator originator;
     Caretaker caretaker;
 
@@ -86,6 +917,48 @@ int main() {
     originator.RestoreState(caretaker.GetMemento(1));
     std::cout << "Restored to: " << originator.GetState() << std::endl;
 
+    // Same history, stored as deltas
+    // Version 0 is a keyframe; restoring version 2 replays the deltas 1 and 2
+    const std::vector<std::string> versions{"State 1 of the document", "State 1 of the edited document",
+                                            "State 1 of the edited document, twice",
+                                            "State 2 of the edited document, twice"};
+    DeltaCaretaker deltaCaretaker(4);
+    for (const std::string& text : versions) {
+        originator.SetState(text);
+        deltaCaretaker.AddMemento(originator.CreateMemento());
+    }
+    originator.RestoreState(deltaCaretaker.GetMemento(2));
+    if (originator.GetState() != versions[2]) throw std::logic_error("delta restore rebuilt the wrong state");
+    std::cout << "Restored from deltas to: " << originator.GetState() << std::endl;
+
+    // History that survives a restart
+    const std::string path = (std::filesystem::temp_directory_path() / "memento_example.log").string();
+    std::filesystem::remove(path);
+    {
+        PersistentCaretaker persistent(path);
+        originator.SetState("State 1");
+        persistent.AddMemento(originator.CreateMemento());
+        originator.SetState("State 2");
+        persistent.AddMemento(originator.CreateMemento());
+    }
+    {
+        PersistentCaretaker persistent(path);
+        originator.RestoreState(persistent.GetMemento(0));
+        std::cout << "Restored from " << persistent.Size() << " saved states to: " << originator.GetState() << std::endl;
+    }
+    std::filesystem::remove(path);
+
+    // Snapshots that share everything but the edited path
+    RopeOriginator editor;
+    BasicCaretaker<RopeOriginator::Memento> undo;
+    editor.SetState("State 1");
+    undo.AddMemento(editor.CreateMemento());
+    editor.Insert(5, " number");
+    undo.AddMemento(editor.CreateMemento());
+    editor.RestoreState(undo.GetMemento(0));
+    std::cout << "Rope restored to: " << editor.GetState() << " (newer snapshot: "
+              << undo.GetMemento(1).GetSavedState().ToString() << ")" << std::endl;
+
     return 0;
 }
 
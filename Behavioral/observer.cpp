@@ -1,41 +1,442 @@
 // observer.cpp
 
-/* 
+/*
 --- Problem statement ---
 Suppose you are developing a weather monitoring application, in which multiple
 weather stations are responsible for collecting weather data, and you want to
 create a system where multiple displays can show real-time weather updates.
 When a weather station collects new data, all registered displays should be
-updated automatically with the latest information. 
+updated automatically with the latest information.
+
+--- Concurrent subscribers ---
+Measurements may be published from many threads while displays come and go.
+The station keeps its observers in an immutable snapshot. Notifying reads the
+current snapshot without locks or allocation; registering or removing an
+observer copies the list, publishes the new snapshot, and retires the old one
+once no notifying thread can still be reading it (a small epoch-based RCU).
+The station only holds weak references: an observer whose owner drops it is
+skipped when notifying and pruned from the next copy.
+
+--- Streaming ---
+For high-rate stations the sensor thread can stream readings instead. Each
+reading is appended to a single-producer/single-consumer ring buffer, and a
+delivery thread hands observers whole contiguous runs of readings through
+updateBatch(), one virtual call per batch instead of one per reading.
 */
 
 #include <iostream>
 #include <vector>
 #include <memory>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+// One sample from the station
+struct Reading {
+    float temperature;
+    float humidity;
+    float pressure;
+};
 
 // Observer interface
 class Observer : public std::enable_shared_from_this<Observer> {
 public:
     virtual void update(float temperature, float humidity, float pressure) = 0;
+
+    // Streaming delivery: `count` consecutive readings, oldest first.
+    // Observers that can work on a whole batch should override this.
+    virtual void updateBatch(const Reading* readings, std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) {
+            update(readings[i].temperature, readings[i].humidity, readings[i].pressure);
+        }
+    }
+
     virtual ~Observer() = default;
 };
 
+// Single-producer/single-consumer ring buffer
+// One thread pushes, one other thread reads. The consumer sees the readable
+// part as at most two contiguous runs (before and after the wrap point).
+template <typename T, std::size_t Capacity>
+class SpscRing {
+private:
+    static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+    std::unique_ptr<T[]> buffer{new T[Capacity]};
+    alignas(64) std::atomic<std::size_t> head{0};   // next slot to write, owned by the producer
+    alignas(64) std::atomic<std::size_t> tail{0};   // next slot to read, owned by the consumer
+    alignas(64) std::size_t cachedTail = 0;          // producer's last view of tail
+    alignas(64) std::size_t cachedHead = 0;          // consumer's last view of head
+
+public:
+    bool tryPush(const T& item) {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if (h - cachedTail == Capacity) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h - cachedTail == Capacity) return false;
+        }
+        buffer[h & (Capacity - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Longest contiguous run of unread items, without consuming them
+    std::pair<const T*, std::size_t> readable() {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        if (cachedHead == t) cachedHead = head.load(std::memory_order_acquire);
+        std::size_t available = cachedHead - t;
+        std::size_t index = t & (Capacity - 1);
+        return {buffer.get() + index, std::min(available, Capacity - index)};
+    }
+
+    void consume(std::size_t count) {
+        tail.store(tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
+
+// Epoch-based reclamation
+// A thread that is reading a snapshot publishes the epoch it started in. A
+// retired snapshot may be freed once no thread is reading from an epoch that
+// began before it was retired.
+class Epoch {
+private:
+    static constexpr std::size_t kMaxReaders = 256;
+
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> epoch{0};   // 0 = not reading
+        std::atomic<bool> taken{false};
+    };
+
+    // Hands the thread's slot back when the thread exits
+    struct SlotOwner {
+        Slot* slot = nullptr;
+        std::size_t depth = 0;   // ReadGuards currently open on this thread
+        ~SlotOwner() {
+            if (slot) slot->taken.store(false, std::memory_order_release);
+        }
+    };
+
+    static Slot* slots() {
+        static Slot all[kMaxReaders];
+        return all;
+    }
+
+    static std::atomic<std::uint64_t>& global() {
+        static std::atomic<std::uint64_t> epoch{1};
+        return epoch;
+    }
+
+    static SlotOwner& mySlot() {
+        thread_local SlotOwner owner;
+        while (!owner.slot) {
+            for (std::size_t i = 0; i < kMaxReaders; ++i) {
+                bool expected = false;
+                if (slots()[i].taken.compare_exchange_strong(expected, true)) {
+                    owner.slot = &slots()[i];
+                    break;
+                }
+            }
+            if (!owner.slot) std::this_thread::yield();   // every slot in use, wait for a thread to exit
+        }
+        return owner;
+    }
+
+public:
+    // Marks the calling thread as reading until the guard goes out of scope.
+    // Guards nest: an observer may read the list again from inside a callback.
+    // Only the outermost guard publishes and clears the epoch, so an inner
+    // guard cannot end the protection the outer one still relies on.
+    class ReadGuard {
+    private:
+        SlotOwner& owner;
+
+    public:
+        ReadGuard() : owner(mySlot()) {
+            if (owner.depth++ == 0) owner.slot->epoch.store(global().load());
+        }
+        ~ReadGuard() {
+            if (--owner.depth == 0) owner.slot->epoch.store(0, std::memory_order_release);
+        }
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+    };
+
+    // Call after unpublishing an object; returns the epoch it was retired in
+    static std::uint64_t retire() {
+        return global().fetch_add(1) + 1;
+    }
+
+    static bool safeToFree(std::uint64_t retiredEpoch) {
+        for (std::size_t i = 0; i < kMaxReaders; ++i) {
+            std::uint64_t e = slots()[i].epoch.load();
+            if (e != 0 && e < retiredEpoch) return false;
+        }
+        return true;
+    }
+};
+
+// Immutable list of observers, replaced as a whole on every change
+class SubscriberList {
+private:
+    // Weak references, as the station does not own its observers
+    struct Snapshot {
+        std::vector<std::weak_ptr<Observer>> observers;
+    };
+
+    // The current list without the observers that have expired since
+    Snapshot* copyLive() const {
+        auto next = new Snapshot();
+        const auto& observers = current.load()->observers;
+        next->observers.reserve(observers.size() + 1);
+        for (const auto& observer : observers) {
+            if (!observer.expired()) next->observers.push_back(observer);
+        }
+        return next;
+    }
+
+    std::atomic<const Snapshot*> current{new Snapshot()};
+    std::mutex writerMutex;                                  // serializes writers only
+    std::vector<std::pair<std::uint64_t, const Snapshot*>> retired;
+
+    void publish(Snapshot* next) {
+        const Snapshot* previous = current.exchange(next);
+        retired.emplace_back(Epoch::retire(), previous);
+        retired.erase(
+            std::remove_if(retired.begin(), retired.end(),
+                [](const std::pair<std::uint64_t, const Snapshot*>& r) {
+                    if (!Epoch::safeToFree(r.first)) return false;
+                    delete r.second;
+                    return true;
+                }),
+            retired.end());
+    }
+
+public:
+    SubscriberList() = default;
+    SubscriberList(const SubscriberList&) = delete;
+    SubscriberList& operator=(const SubscriberList&) = delete;
+
+    ~SubscriberList() {
+        delete current.load();
+        for (auto& r : retired) delete r.second;
+    }
+
+    void add(std::shared_ptr<Observer> observer) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        auto next = copyLive();
+        next->observers.push_back(std::move(observer));
+        publish(next);
+    }
+
+    void remove(const std::shared_ptr<Observer>& observer) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        auto next = copyLive();
+        next->observers.erase(
+            std::remove_if(next->observers.begin(), next->observers.end(),
+                [&observer](const std::weak_ptr<Observer>& o) {
+                    return !o.owner_before(observer) && !observer.owner_before(o);
+                }),
+            next->observers.end());
+        publish(next);
+    }
+
+    template <typename F>
+    void forEach(F&& f) const {
+        Epoch::ReadGuard guard;
+        const Snapshot* snapshot = current.load();
+        for (const auto& weakObserver : snapshot->observers) {
+            if (auto observer = weakObserver.lock()) f(*observer);
+        }
+    }
+
+    // Includes observers that expired after the last change
+    std::size_t size() const {
+        Epoch::ReadGuard guard;
+        return current.load()->observers.size();
+    }
+};
+
 // Subject (WeatherStation)
 class WeatherStation {
 private:
-    float temperature{};
-    float humidity{};
-    float pressure{};
+    std::atomic<float> temperature{};
+    std::atomic<float> humidity{};
+    std::atomic<float> pressure{};
+
+    SubscriberList observers;
+
+    static constexpr std::size_t kStreamCapacity = 1 << 14;
+    std::unique_ptr<SpscRing<Reading, kStreamCapacity>> stream;
+    std::thread deliverer;
+    std::atomic<bool> streaming{false};
+
+    // An idle deliverer yields for a while, then parks. The producer only
+    // signals when it sees the deliverer parked; a wake-up missed in between
+    // costs at most kParkTimeout of latency, never a lost reading.
+    static constexpr int kSpinsBeforePark = 64;
+    static constexpr std::chrono::microseconds kParkTimeout{200};
+    std::atomic<bool> parked{false};
+    std::mutex parkMutex;
+    std::condition_variable readingsQueued;
+
+    // One notify per park, not one per reading while the deliverer wakes up
+    void wakeDeliverer() {
+        if (!parked.load(std::memory_order_relaxed) || !parked.exchange(false)) return;
+        std::lock_guard<std::mutex> lock(parkMutex);
+        readingsQueued.notify_one();
+    }
+
+    void deliverLoop(std::size_t maxBatch) {
+        int idle = 0;
+        while (true) {
+            auto run = stream->readable();
+            if (run.second == 0) {
+                if (!streaming.load(std::memory_order_acquire) && stream->empty()) return;
+                if (++idle < kSpinsBeforePark) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(parkMutex);
+                parked.store(true);
+                readingsQueued.wait_for(lock, kParkTimeout, [this] {
+                    return !stream->empty() || !streaming.load(std::memory_order_acquire);
+                });
+                parked.store(false);
+                idle = 0;
+                continue;
+            }
+            idle = 0;
+            std::size_t count = std::min(run.second, maxBatch);
+            const Reading* batch = run.first;
+            observers.forEach([batch, count](Observer& obs) {
+                obs.updateBatch(batch, count);
+            });
+            const Reading& latest = batch[count - 1];
+            temperature = latest.temperature;
+            humidity = latest.humidity;
+            pressure = latest.pressure;
+            stream->consume(count);
+        }
+    }
+
+public:
+    void registerObserver(std::shared_ptr<Observer> observer) {
+        observers.add(std::move(observer));
+    }
+
+    void removeObserver(std::shared_ptr<Observer> observer) {
+        observers.remove(observer);
+    }
+
+    void notifyObservers() {
+        notifyObservers(temperature, humidity, pressure);
+    }
+
+    // Notifies with the given values, so concurrent publishers never mix readings
+    void notifyObservers(float temp, float hum, float press) {
+        observers.forEach([=](Observer& obs) {
+            obs.update(temp, hum, press);
+        });
+    }
 
+    void setMeasurements(float temp, float hum, float press) {
+        temperature = temp;
+        humidity = hum;
+        pressure = press;
+        notifyObservers(temp, hum, press);
+    }
+
+    ~WeatherStation() {
+        stopStreaming();
+    }
+
+    // Starts the delivery thread. Batches hold at most `maxBatch` readings.
+    void startStreaming(std::size_t maxBatch = 1024) {
+        if (streaming) return;
+        if (!stream) stream = std::make_unique<SpscRing<Reading, kStreamCapacity>>();
+        streaming = true;
+        deliverer = std::thread(&WeatherStation::deliverLoop, this, maxBatch);
+    }
+
+    // Queues one reading. Only one thread may stream into a station; when
+    // observers fall behind and the ring is full, the caller waits. Returns
+    // false, dropping the reading, if the station is not streaming.
+    bool streamMeasurement(float temp, float hum, float press) {
+        if (!streaming.load(std::memory_order_acquire)) return false;
+        Reading reading{temp, hum, press};
+        for (int attempt = 0; !stream->tryPush(reading); ++attempt) {
+            if (!streaming.load(std::memory_order_acquire)) return false;
+            wakeDeliverer();
+            if (attempt < kSpinsBeforePark) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+        wakeDeliverer();
+        return true;
+    }
+
+    // Delivers everything still queued, then stops the delivery thread
+    void stopStreaming() {
+        if (!streaming) return;
+        {
+            std::lock_guard<std::mutex> lock(parkMutex);
+            streaming.store(false, std::memory_order_release);
+        }
+        readingsQueued.notify_one();
+        deliverer.join();
+    }
+};
+
+// Concrete Observer
+class Display : public Observer {
+public:
+    void update(float temperature, float humidity, float pressure) override {
+        std::cout << "Display: Temperature = " << temperature
+                  << "°C, Humidity = " << humidity
+                  << "%, Pressure = " << pressure << " hPa"
+                  << std::endl;
+    }
+
+    // One flush per batch instead of one per reading
+    void updateBatch(const Reading* readings, std::size_t count) override {
+        for (std::size_t i = 0; i < count; ++i) {
+            std::cout << "Display: Temperature = " << readings[i].temperature
+                      << "°C, Humidity = " << readings[i].humidity
+                      << "%, Pressure = " << readings[i].pressure << " hPa\n";
+        }
+        std::cout.flush();
+    }
+};
+
+// Benchmark
+// The previous design: a weak_ptr vector pruned on every notify, guarded by a
+// mutex so that it is safe to use from several threads at all.
+class LockedWeatherStation {
+private:
+    std::mutex mutex;
     std::vector<std::weak_ptr<Observer>> observers;
 
 public:
     void registerObserver(std::shared_ptr<Observer> observer) {
+        std::lock_guard<std::mutex> lock(mutex);
         observers.push_back(observer);
     }
 
     void removeObserver(std::shared_ptr<Observer> observer) {
+        std::lock_guard<std::mutex> lock(mutex);
         observers.erase(
             std::remove_if(observers.begin(), observers.end(),
                 [&observer](const std::weak_ptr<Observer>& o) {
@@ -44,40 +445,174 @@ public:
             observers.end());
     }
 
-    void notifyObservers() {
-        // Clean expired observers and notify valid ones
+    void setMeasurements(float temp, float hum, float press) {
+        std::lock_guard<std::mutex> lock(mutex);
         observers.erase(
             std::remove_if(observers.begin(), observers.end(),
                 [](const std::weak_ptr<Observer>& o) { return o.expired(); }),
             observers.end());
-
         for (auto& weakObs : observers) {
-            if (auto obs = weakObs.lock()) {  // Promote weak_ptr to shared_ptr
-                obs->update(temperature, humidity, pressure);
+            if (auto obs = weakObs.lock()) {
+                obs->update(temp, hum, press);
             }
         }
     }
+};
 
-    void setMeasurements(float temp, float hum, float press) {
-        temperature = temp;
-        humidity = hum;
-        pressure = press;
-        notifyObservers();
+// Counts updates per thread so the observers themselves are not contended
+thread_local std::uint64_t updatesSeen = 0;
+
+class CountingDisplay : public Observer {
+public:
+    void update(float temperature, float /*humidity*/, float /*pressure*/) override {
+        updatesSeen += temperature > -300.0f;
     }
 };
 
-// Concrete Observer
-class Display : public Observer {
+template <typename Station>
+void runContention(const char* name, int publishers, int subscribers, int milliseconds) {
+    Station station;
+    std::vector<std::shared_ptr<Observer>> steady;
+    for (int i = 0; i < 16; ++i) {
+        steady.push_back(std::make_shared<CountingDisplay>());
+        station.registerObserver(steady.back());
+    }
+
+    std::atomic<bool> running{true};
+    std::atomic<std::uint64_t> notifications{0};
+    std::atomic<std::uint64_t> updates{0};
+    std::atomic<std::uint64_t> changes{0};
+    std::vector<std::thread> threads;
+
+    for (int p = 0; p < publishers; ++p) {
+        threads.emplace_back([&] {
+            std::uint64_t count = 0;
+            while (running.load(std::memory_order_relaxed)) {
+                station.setMeasurements(20.0f + count % 10, 50.0f, 1013.0f);
+                ++count;
+            }
+            notifications += count;
+            updates += updatesSeen;
+        });
+    }
+    for (int s = 0; s < subscribers; ++s) {
+        threads.emplace_back([&] {
+            std::uint64_t count = 0;
+            while (running.load(std::memory_order_relaxed)) {
+                auto display = std::make_shared<CountingDisplay>();
+                station.registerObserver(display);
+                station.removeObserver(display);
+                count += 2;
+            }
+            changes += count;
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+    running = false;
+    for (auto& t : threads) t.join();
+
+    double seconds = milliseconds / 1000.0;
+    std::cout << "  " << name << ": " << publishers << " publishers, " << subscribers << " subscribers: "
+              << notifications / seconds / 1e6 << " M notifies/s, "
+              << updates / seconds / 1e6 << " M updates/s, "
+              << changes / seconds / 1e3 << " k register+remove/s\n";
+}
+
+// Writes every reading to a log, like Display but without a terminal
+class LogDisplay : public Observer {
+private:
+    std::ofstream log{"/dev/null"};
+
 public:
     void update(float temperature, float humidity, float pressure) override {
-        std::cout << "Display: Temperature = " << temperature
-                  << "°C, Humidity = " << humidity
-                  << "%, Pressure = " << pressure << " hPa"
-                  << std::endl;
+        log << temperature << ' ' << humidity << ' ' << pressure << std::endl;
+    }
+
+    void updateBatch(const Reading* readings, std::size_t count) override {
+        for (std::size_t i = 0; i < count; ++i) {
+            log << readings[i].temperature << ' ' << readings[i].humidity << ' ' << readings[i].pressure << '\n';
+        }
+        log.flush();
+    }
+};
+
+class SummingDisplay : public Observer {
+public:
+    double sum = 0;
+
+    void update(float temperature, float /*humidity*/, float /*pressure*/) override {
+        sum += temperature;
+    }
+
+    void updateBatch(const Reading* readings, std::size_t count) override {
+        for (std::size_t i = 0; i < count; ++i) sum += readings[i].temperature;
     }
 };
 
-int main() {
+template <typename Display>
+void runStreaming(const char* name, std::size_t readings) {
+    using Clock = std::chrono::steady_clock;
+    auto seconds = [](Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    };
+
+    double perReading = 0;
+    {
+        WeatherStation station;
+        std::vector<std::shared_ptr<Display>> displays;
+        for (int i = 0; i < 4; ++i) {
+            displays.push_back(std::make_shared<Display>());
+            station.registerObserver(displays.back());
+        }
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < readings; ++i) {
+            station.setMeasurements(20.0f + i % 10, 50.0f, 1013.0f);
+        }
+        perReading = readings / seconds(start);
+    }
+
+    double streamed = 0;
+    {
+        WeatherStation station;
+        std::vector<std::shared_ptr<Display>> displays;
+        for (int i = 0; i < 4; ++i) {
+            displays.push_back(std::make_shared<Display>());
+            station.registerObserver(displays.back());
+        }
+        auto start = Clock::now();
+        station.startStreaming();
+        for (std::size_t i = 0; i < readings; ++i) {
+            station.streamMeasurement(20.0f + i % 10, 50.0f, 1013.0f);
+        }
+        station.stopStreaming();
+        streamed = readings / seconds(start);
+    }
+
+    std::cout << "  " << name << " x4: per-reading notify " << perReading / 1e6
+              << " M readings/s, streamed " << streamed / 1e6 << " M readings/s\n";
+}
+
+void runBenchmark() {
+    std::cout << "Streaming benchmark (1M readings)\n";
+    runStreaming<SummingDisplay>("in-memory observer", 1000000);
+    runStreaming<LogDisplay>("log observer      ", 1000000);
+
+    std::cout << "Contention benchmark (16 steady observers, 500 ms per run)\n";
+    const int configs[][2] = {{1, 0}, {4, 0}, {4, 1}, {4, 4}, {8, 2}};
+    for (const auto& config : configs) {
+        runContention<LockedWeatherStation>("mutex", config[0], config[1], 500);
+        runContention<WeatherStation>("rcu  ", config[0], config[1], 500);
+    }
+}
+
+// Usage: observer [--bench]
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        runBenchmark();
+        return 0;
+    }
+
     WeatherStation weatherStation;
 
     auto display1 = std::make_shared<Display>();
@@ -94,5 +629,17 @@ int main() {
 
     weatherStation.setMeasurements(23.3, 55, 1015.0);
 
+    // Streaming mode: display2 receives the burst as batches
+    weatherStation.startStreaming();
+    for (int i = 0; i < 3; ++i) {
+        weatherStation.streamMeasurement(23.0f - i * 0.5f, 55.0f + i, 1015.0f);
+    }
+    weatherStation.stopStreaming();
+
+    // Nothing delivers once streaming has stopped, so the reading is refused
+    if (!weatherStation.streamMeasurement(22.0f, 58.0f, 1015.0f)) {
+        std::cout << "Station is not streaming, reading dropped\n";
+    }
+
     return 0;
 }
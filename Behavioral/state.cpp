@@ -5,15 +5,66 @@
 We have to design a simple traffic light system. The traffic light system 
 consists of different states: Red, Yellow, and Green and the behavior of the 
 traffic light is determined by its current state.
+
+--- Allocation-free states ---
+TrafficLight allocates a state object for every setState() and reaches it
+through a virtual call. VariantTrafficLight holds one of the empty types Red,
+Yellow or Green in a std::variant. setState<Green>() assigns in place, and
+next() follows the compile-time table NextLight (red -> green -> yellow ->
+red). Visiting three alternatives compiles to a switch, so a transition needs
+no allocation and no indirect call.
+
+--- Bulk simulation ---
+A city grid has millions of lights, too many for one object each. TrafficGrid
+keeps them as structure-of-arrays: one byte of state and one 16-bit countdown
+per light. tick() decrements every countdown, moves expired lights to their
+next state and restarts their countdown from LightTimings. Lights are split
+into contiguous slices, one per worker; each slice runs an AVX2 kernel (16
+lights per step) when the CPU has one and appends the indices of the lights
+that changed. tick() returns only those indices, in ascending order.
+
+--- Timed transitions ---
+Nothing above changes on its own; a caller has to drive every transition.
+TimerWheel schedules "switch this light in 30 ticks" for millions of lights. It
+is a hierarchical timing wheel: four levels of 256 slots, each level 256 times
+coarser than the one below. A timer goes into the finest level whose window
+holds its deadline and moves down a level each time its slot comes up. Each
+slot is an array of node indices and every node records its position, so
+schedule() appends and cancel() swaps the last entry into the gap, both O(1).
+advanceTo() hands all timers due on the same tick to the caller as one batch.
+ScheduledTrafficLights uses it to switch VariantTrafficLights on their
+LightTimings.
 */
 
 #include <iostream>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
 #include <memory>  // for std::unique_ptr
+#include <mutex>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STATE_X86 1
+#endif
 
 // State Interface
 class TrafficLightState {
 public:
     virtual void handle() = 0;
+    virtual const char* name() const = 0;
     virtual ~TrafficLightState() = default;  // virtual destructor for safety
 };
 
@@ -23,6 +74,8 @@ public:
     void handle() override {
         std::cout << "Traffic Light is Red\n";
     }
+
+    const char* name() const override { return "Red"; }
 };
 
 class YellowState : public TrafficLightState {
@@ -30,6 +83,8 @@ public:
     void handle() override {
         std::cout << "Traffic Light is Yellow\n";
     }
+
+    const char* name() const override { return "Yellow"; }
 };
 
 class GreenState : public TrafficLightState {
@@ -37,6 +92,8 @@ public:
     void handle() override {
         std::cout << "Traffic Light is Green\n";
     }
+
+    const char* name() const override { return "Green"; }
 };
 
 // Context
@@ -52,9 +109,739 @@ public:
     }
 
     void change() { state->handle(); }
+
+    const char* stateName() const { return state->name(); }
+};
+
+// Allocation-free states
+// Light codes follow NextLight: red -> green -> yellow -> red
+enum LightCode : std::uint8_t { kRedLight = 0, kGreenLight = 1, kYellowLight = 2 };
+
+struct Red {
+    static constexpr const char* name = "Red";
+    static constexpr LightCode code = kRedLight;
+};
+
+struct Yellow {
+    static constexpr const char* name = "Yellow";
+    static constexpr LightCode code = kYellowLight;
+};
+
+struct Green {
+    static constexpr const char* name = "Green";
+    static constexpr LightCode code = kGreenLight;
+};
+
+// Transition table for the usual cycle
+template <typename State>
+struct NextLight;
+template <>
+struct NextLight<Red> { using type = Green; };
+template <>
+struct NextLight<Green> { using type = Yellow; };
+template <>
+struct NextLight<Yellow> { using type = Red; };
+
+class VariantTrafficLight {
+private:
+    std::variant<Red, Yellow, Green> state;   // starts Red
+
+public:
+    template <typename State>
+    void setState() {
+        state = State{};
+    }
+
+    void next() {
+        std::visit([this](auto current) { state = typename NextLight<decltype(current)>::type{}; }, state);
+    }
+
+    void change() const {
+        std::cout << "Traffic Light is " << stateName() << "\n";
+    }
+
+    const char* stateName() const {
+        return std::visit([](auto current) { return decltype(current)::name; }, state);
+    }
+
+    LightCode code() const {
+        return std::visit([](auto current) { return decltype(current)::code; }, state);
+    }
+};
+
+// Bulk simulation
+const char* lightName(std::uint8_t code) {
+    static const char* const names[] = {"Red", "Green", "Yellow"};
+    return names[code];
+}
+
+// Ticks spent in each state; every duration must be at least 1
+struct LightTimings {
+    std::uint16_t red;
+    std::uint16_t green;
+    std::uint16_t yellow;
+
+    std::uint16_t durationOf(std::uint8_t code) const {
+        return code == kRedLight ? red : code == kGreenLight ? green : yellow;
+    }
+};
+
+// Grid kernels
+// Advance lights [0, n) by one tick. Writes first + i to `changed` for every
+// light i that switched state and returns how many were written.
+struct GridKernels {
+    const char* name;
+    std::size_t (*tick)(std::uint8_t* states, std::uint16_t* timers, std::size_t n,
+                        const LightTimings& timings, std::uint32_t first, std::uint32_t* changed);
+};
+
+std::size_t tickScalar(std::uint8_t* states, std::uint16_t* timers, std::size_t n,
+                       const LightTimings& timings, std::uint32_t first, std::uint32_t* changed) {
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (--timers[i] != 0) continue;
+        std::uint8_t next = states[i] == kYellowLight ? kRedLight : states[i] + 1;
+        states[i] = next;
+        timers[i] = timings.durationOf(next);
+        changed[count++] = first + static_cast<std::uint32_t>(i);
+    }
+    return count;
+}
+
+#ifdef STATE_X86
+__attribute__((target("avx2")))
+std::size_t tickAvx2(std::uint8_t* states, std::uint16_t* timers, std::size_t n,
+                     const LightTimings& timings, std::uint32_t first, std::uint32_t* changed) {
+    const __m256i one = _mm256_set1_epi16(1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i red = _mm256_set1_epi16(static_cast<short>(timings.red));
+    const __m256i green = _mm256_set1_epi16(static_cast<short>(timings.green));
+    const __m256i yellow = _mm256_set1_epi16(static_cast<short>(timings.yellow));
+    const __m256i greenCode = _mm256_set1_epi16(kGreenLight);
+    const __m256i yellowCode = _mm256_set1_epi16(kYellowLight);
+    const __m128i nextCode = _mm_setr_epi8(kGreenLight, kYellowLight, kRedLight, 0, 0, 0, 0, 0,
+                                           0, 0, 0, 0, 0, 0, 0, 0);
+
+    std::size_t count = 0;
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i timer = _mm256_sub_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(timers + i)), one);
+        __m256i expired = _mm256_cmpeq_epi16(timer, zero);
+        __m128i expiredBytes = _mm_packs_epi16(_mm256_castsi256_si128(expired), _mm256_extracti128_si256(expired, 1));
+
+        __m128i state = _mm_loadu_si128(reinterpret_cast<const __m128i*>(states + i));
+        state = _mm_blendv_epi8(state, _mm_shuffle_epi8(nextCode, state), expiredBytes);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(states + i), state);
+
+        __m256i wide = _mm256_cvtepu8_epi16(state);
+        __m256i duration = _mm256_blendv_epi8(red, green, _mm256_cmpeq_epi16(wide, greenCode));
+        duration = _mm256_blendv_epi8(duration, yellow, _mm256_cmpeq_epi16(wide, yellowCode));
+        timer = _mm256_blendv_epi8(timer, duration, expired);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(timers + i), timer);
+
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(expiredBytes));
+        for (; mask != 0; mask &= mask - 1) {
+            changed[count++] = first + static_cast<std::uint32_t>(i + __builtin_ctz(mask));
+        }
+    }
+    return count + tickScalar(states + i, timers + i, n - i, timings,
+                              first + static_cast<std::uint32_t>(i), changed + count);
+}
+#endif
+
+const GridKernels kScalarGridKernels{"scalar", tickScalar};
+#ifdef STATE_X86
+const GridKernels kAvx2GridKernels{"avx2", tickAvx2};
+#endif
+
+// Every kernel set this CPU can run, best first
+std::vector<const GridKernels*> availableGridKernels() {
+    std::vector<const GridKernels*> kernels;
+#ifdef STATE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) kernels.push_back(&kAvx2GridKernels);
+#endif
+    kernels.push_back(&kScalarGridKernels);
+    return kernels;
+}
+
+const GridKernels& gridKernels() {
+    static const GridKernels* best = availableGridKernels().front();
+    return *best;
+}
+
+// Fork-join team: run(job) calls job(0..size()-1) once each, job(0) on the
+// calling thread, and returns when all calls have finished.
+class WorkerTeam {
+private:
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable started;
+    std::condition_variable finished;
+    const std::function<void(std::size_t)>* job = nullptr;
+    std::size_t generation = 0;
+    std::size_t pending = 0;
+    bool stopping = false;
+
+    void workerLoop(std::size_t index) {
+        std::size_t seen = 0;
+        for (;;) {
+            const std::function<void(std::size_t)>* current;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                started.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+                current = job;
+            }
+            (*current)(index);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) finished.notify_one();
+        }
+    }
+
+public:
+    explicit WorkerTeam(std::size_t workers) {
+        for (std::size_t i = 1; i < std::max<std::size_t>(workers, 1); ++i) {
+            threads.emplace_back(&WorkerTeam::workerLoop, this, i);
+        }
+    }
+
+    ~WorkerTeam() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        started.notify_all();
+        for (auto& thread : threads) thread.join();
+    }
+
+    WorkerTeam(const WorkerTeam&) = delete;
+    WorkerTeam& operator=(const WorkerTeam&) = delete;
+
+    std::size_t size() const { return threads.size() + 1; }
+
+    void run(const std::function<void(std::size_t)>& work) {
+        if (threads.empty()) {
+            work(0);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &work;
+            pending = threads.size();
+            ++generation;
+        }
+        started.notify_all();
+        work(0);
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return pending == 0; });
+    }
+};
+
+class TrafficGrid {
+private:
+    // Slices start on a multiple of this many lights, so only the last one has a scalar tail
+    static constexpr std::size_t kSliceAlignment = 64;
+
+    struct Slice {
+        std::size_t begin;
+        std::size_t end;
+        std::vector<std::uint32_t> changed;   // capacity for every light in the slice
+        std::size_t changedCount = 0;
+    };
+
+    std::vector<std::uint8_t> states;
+    std::vector<std::uint16_t> timers;
+    LightTimings timings;
+    const GridKernels* kernels;
+    std::vector<Slice> slices;
+    std::vector<std::uint32_t> changes;
+    WorkerTeam team;
+    std::function<void(std::size_t)> tickSlice;
+
+public:
+    // Lights start in a random state, part way through it, so they do not all switch together
+    TrafficGrid(std::size_t lights, LightTimings timings,
+                std::size_t threads = std::thread::hardware_concurrency(),
+                const GridKernels& kernels = gridKernels(), unsigned seed = 1)
+        : states(lights), timers(lights), timings(timings), kernels(&kernels),
+          team(std::max<std::size_t>(1, std::min(threads, lights / kSliceAlignment))) {
+        if (timings.red == 0 || timings.green == 0 || timings.yellow == 0) {
+            throw std::invalid_argument("Every light duration must be at least one tick");
+        }
+        if (lights > UINT32_MAX) throw std::length_error("Too many lights for 32-bit indices");
+
+        std::mt19937 random(seed);
+        for (std::size_t i = 0; i < lights; ++i) {
+            states[i] = static_cast<std::uint8_t>(random() % 3);
+            timers[i] = static_cast<std::uint16_t>(1 + random() % timings.durationOf(states[i]));
+        }
+
+        std::size_t perSlice = (lights / team.size() + kSliceAlignment - 1) / kSliceAlignment * kSliceAlignment;
+        for (std::size_t w = 0; w < team.size(); ++w) {
+            std::size_t begin = std::min(lights, w * perSlice);
+            std::size_t end = w + 1 == team.size() ? lights : std::min(lights, begin + perSlice);
+            slices.push_back(Slice{begin, end, std::vector<std::uint32_t>(end - begin)});
+        }
+        tickSlice = [this](std::size_t w) {
+            Slice& slice = slices[w];
+            slice.changedCount = this->kernels->tick(states.data() + slice.begin, timers.data() + slice.begin,
+                                                     slice.end - slice.begin, this->timings,
+                                                     static_cast<std::uint32_t>(slice.begin), slice.changed.data());
+        };
+    }
+
+    TrafficGrid(const TrafficGrid&) = delete;
+    TrafficGrid& operator=(const TrafficGrid&) = delete;
+
+    // Indices of the lights that changed state, valid until the next tick()
+    const std::vector<std::uint32_t>& tick() {
+        team.run(tickSlice);
+
+        std::size_t total = 0;
+        for (const Slice& slice : slices) total += slice.changedCount;
+        changes.resize(total);
+        std::uint32_t* out = changes.data();
+        for (const Slice& slice : slices) {
+            if (slice.changedCount == 0) continue;
+            std::memcpy(out, slice.changed.data(), slice.changedCount * sizeof(std::uint32_t));
+            out += slice.changedCount;
+        }
+        return changes;
+    }
+
+    std::size_t size() const { return states.size(); }
+    std::size_t threadCount() const { return team.size(); }
+    const char* kernelName() const { return kernels->name; }
+    std::uint8_t state(std::size_t light) const { return states[light]; }
+    std::uint16_t ticksLeft(std::size_t light) const { return timers[light]; }
+    const char* stateName(std::size_t light) const { return lightName(states[light]); }
+};
+
+// Timer wheel
+struct TimerId {
+    std::uint32_t index;
+    std::uint32_t generation;   // stale ids are ignored by cancel()
+};
+
+// Payload must be default constructible. Callbacks may schedule and cancel
+// timers, but must not advance the wheel they were called from.
+template <typename Payload>
+class TimerWheel {
+public:
+    static constexpr unsigned kLevels = 4;
+    static constexpr unsigned kSlotBits = 8;
+    static constexpr std::uint32_t kSlots = 1u << kSlotBits;
+    // A longer delay could wrap the top level into the slot being walked
+    static constexpr std::uint64_t kMaxDelay = (std::uint64_t(1) << (kLevels * kSlotBits))
+                                             - (std::uint64_t(1) << ((kLevels - 1) * kSlotBits));
+
+private:
+    static constexpr std::uint16_t kFree = UINT16_MAX;
+    static constexpr std::size_t kPrefetchDistance = 8;
+
+    struct Node {
+        std::uint64_t deadline;
+        std::uint32_t position;     // index in its slot's list
+        std::uint32_t generation;
+        std::uint16_t slot;         // kFree while the node is unused
+        Payload payload;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<std::uint32_t> freeNodes;
+    // Each slot lists its nodes; cancel() swaps the last one into the gap
+    std::array<std::vector<std::uint32_t>, kLevels * kSlots> slots;
+    std::array<std::uint64_t, kLevels * kSlots / 64> occupied{};   // one bit per non-empty slot
+    std::vector<std::uint32_t> moving;
+    std::vector<Payload> batch;
+    std::uint64_t current = 0;
+    std::size_t pending = 0;
+
+    void link(std::uint32_t index) {
+        Node& node = nodes[index];
+        unsigned level = 0;
+        while (level + 1 < kLevels && ((node.deadline ^ current) >> (kSlotBits * (level + 1))) != 0) ++level;
+        std::uint32_t slot = level * kSlots + ((node.deadline >> (kSlotBits * level)) & (kSlots - 1));
+        node.slot = static_cast<std::uint16_t>(slot);
+        node.position = static_cast<std::uint32_t>(slots[slot].size());
+        slots[slot].push_back(index);
+        occupied[slot / 64] |= std::uint64_t(1) << (slot % 64);
+    }
+
+    void unlink(std::uint32_t index) {
+        const Node& node = nodes[index];
+        std::vector<std::uint32_t>& list = slots[node.slot];
+        std::uint32_t last = list.back();
+        list[node.position] = last;
+        nodes[last].position = node.position;
+        list.pop_back();
+        if (list.empty()) occupied[node.slot / 64] &= ~(std::uint64_t(1) << (node.slot % 64));
+    }
+
+    // Moves a slot's list into `moving`, leaving the slot empty
+    void detach(std::uint32_t slot) {
+        moving.clear();
+        moving.swap(slots[slot]);
+        occupied[slot / 64] &= ~(std::uint64_t(1) << (slot % 64));
+    }
+
+    void release(std::uint32_t index) {
+        Node& node = nodes[index];
+        node.slot = kFree;
+        ++node.generation;
+        freeNodes.push_back(index);
+        --pending;
+    }
+
+    void prefetch(std::size_t i) const {
+        if (i < moving.size()) __builtin_prefetch(&nodes[moving[i]], 1);
+    }
+
+    // First occupied slot of `level` at or after `from`, or kSlots
+    std::uint32_t nextOccupied(unsigned level, std::uint32_t from) const {
+        for (std::uint32_t word = from / 64; word < kSlots / 64; ++word) {
+            std::uint64_t bits = occupied[level * kSlots / 64 + word];
+            if (word == from / 64) bits &= ~std::uint64_t(0) << (from % 64);
+            if (bits != 0) return word * 64 + static_cast<std::uint32_t>(__builtin_ctzll(bits));
+        }
+        return kSlots;
+    }
+
+    // The next tick with something to do: a level-0 slot to fire, or the
+    // boundary where a coarser slot comes up. Finer levels always come first.
+    std::uint64_t nextEvent() const {
+        for (unsigned level = 0; level < kLevels; ++level) {
+            unsigned shift = kSlotBits * level;
+            std::uint64_t window = current >> (shift + kSlotBits) << (shift + kSlotBits);
+            std::uint32_t digit = (current >> shift) & (kSlots - 1);
+            std::uint32_t slot = digit + 1 < kSlots ? nextOccupied(level, digit + 1) : kSlots;
+            if (slot < kSlots) return window + (std::uint64_t(slot) << shift);
+            if (level + 1 == kLevels && (slot = nextOccupied(level, 0)) < kSlots) {
+                // Top-level timers that wrapped into the next window
+                return window + (std::uint64_t(1) << (shift + kSlotBits)) + (std::uint64_t(slot) << shift);
+            }
+        }
+        return UINT64_MAX;
+    }
+
+    // On a level-0 wrap, move the slots that just came up on coarser levels down
+    void cascade() {
+        for (unsigned level = 1; level < kLevels; ++level) {
+            std::uint32_t digit = (current >> (kSlotBits * level)) & (kSlots - 1);
+            detach(level * kSlots + digit);
+            for (std::size_t i = 0; i < moving.size(); ++i) {
+                prefetch(i + kPrefetchDistance);
+                link(moving[i]);
+            }
+            if (digit != 0) break;
+        }
+    }
+
+public:
+    TimerWheel() = default;
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    std::uint64_t now() const { return current; }
+    std::size_t size() const { return pending; }
+    void reserve(std::size_t timers) { nodes.reserve(timers); }
+
+    // Fires `delay` ticks from now; a delay of 0 fires on the next tick
+    TimerId schedule(std::uint64_t delay, Payload payload) {
+        if (delay > kMaxDelay) throw std::out_of_range("Timer delay too long");
+        std::uint32_t index;
+        if (!freeNodes.empty()) {
+            index = freeNodes.back();
+            freeNodes.pop_back();
+        } else {
+            if (nodes.size() >= UINT32_MAX) throw std::length_error("Too many timers");
+            index = static_cast<std::uint32_t>(nodes.size());
+            nodes.push_back(Node{});
+        }
+        Node& node = nodes[index];
+        node.deadline = current + std::max<std::uint64_t>(delay, 1);
+        node.payload = std::move(payload);
+        link(index);
+        ++pending;
+        return TimerId{index, node.generation};
+    }
+
+    // False if the timer already fired or was cancelled
+    bool cancel(TimerId id) {
+        if (id.index >= nodes.size()) return false;
+        const Node& node = nodes[id.index];
+        if (node.slot == kFree || node.generation != id.generation) return false;
+        unlink(id.index);
+        release(id.index);
+        return true;
+    }
+
+    // Fires every timer due up to and including `time`: onBatch(tick, payloads)
+    // once per tick that has any, in tick order. Empty slots on every level are
+    // skipped, so the cost does not grow with the length of quiet stretches.
+    template <typename OnBatch>
+    void advanceTo(std::uint64_t time, OnBatch&& onBatch) {
+        while (current < time) {
+            std::uint64_t step = nextEvent();
+            if (step > time) {
+                current = time;
+                break;
+            }
+            current = step;
+            if ((current & (kSlots - 1)) == 0) cascade();
+
+            detach(current & (kSlots - 1));
+            if (moving.empty()) continue;
+            batch.clear();
+            for (std::size_t i = 0; i < moving.size(); ++i) {
+                prefetch(i + kPrefetchDistance);
+                batch.push_back(std::move(nodes[moving[i]].payload));
+                release(moving[i]);
+            }
+            onBatch(current, static_cast<const std::vector<Payload>&>(batch));
+        }
+    }
 };
 
-int main() {
+// Scheduled lights
+// Every light holds its state for the LightTimings duration and then moves on.
+// hold() keeps a light in its current state for longer, say for an emergency vehicle.
+class ScheduledTrafficLights {
+private:
+    std::vector<VariantTrafficLight> lights;
+    std::vector<TimerId> timers;
+    LightTimings timings;
+    TimerWheel<std::uint32_t> wheel;
+
+public:
+    // All lights start red; light i first turns green after 1 + i % red ticks
+    ScheduledTrafficLights(std::size_t count, LightTimings timings)
+        : lights(count), timers(count), timings(timings) {
+        if (timings.red == 0 || timings.green == 0 || timings.yellow == 0) {
+            throw std::invalid_argument("Every light duration must be at least one tick");
+        }
+        wheel.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            timers[i] = wheel.schedule(1 + i % timings.red, static_cast<std::uint32_t>(i));
+        }
+    }
+
+    // Switches every light that is due by `time`; onChange(tick, light) for each
+    template <typename OnChange>
+    void advanceTo(std::uint64_t time, OnChange&& onChange) {
+        wheel.advanceTo(time, [&](std::uint64_t tick, const std::vector<std::uint32_t>& due) {
+            for (std::uint32_t light : due) {
+                lights[light].next();
+                timers[light] = wheel.schedule(timings.durationOf(lights[light].code()), light);
+                onChange(tick, light);
+            }
+        });
+    }
+
+    void hold(std::size_t light, std::uint64_t ticks) {
+        wheel.cancel(timers[light]);
+        timers[light] = wheel.schedule(ticks, static_cast<std::uint32_t>(light));
+    }
+
+    std::uint64_t now() const { return wheel.now(); }
+    std::size_t size() const { return lights.size(); }
+    const VariantTrafficLight& light(std::size_t index) const { return lights[index]; }
+};
+
+// Benchmark
+// Cycles through the three states; every step reads the state back so the
+// work cannot be skipped.
+using Clock = std::chrono::steady_clock;
+
+void runBenchmark(long transitions) {
+    std::cout << "Benchmark: " << transitions << " transitions\n";
+
+    TrafficLight light;
+    long checksum = 0;
+    auto start = Clock::now();
+    for (long i = 0; i < transitions; ++i) {
+        switch (i % 3) {
+        case 0: light.setState(std::make_unique<GreenState>()); break;
+        case 1: light.setState(std::make_unique<YellowState>()); break;
+        default: light.setState(std::make_unique<RedState>()); break;
+        }
+        checksum += light.stateName()[0];
+    }
+    double classicSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    VariantTrafficLight variantLight;
+    long variantChecksum = 0;
+    start = Clock::now();
+    for (long i = 0; i < transitions; ++i) {
+        variantLight.next();
+        variantChecksum += variantLight.stateName()[0];
+    }
+    double variantSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::cout << "  unique_ptr states: " << transitions / classicSeconds / 1e6 << " M transitions/s\n"
+              << "  variant states:    " << transitions / variantSeconds / 1e6 << " M transitions/s\n"
+              << "  checksums: " << checksum << " / " << variantChecksum << "\n";
+}
+
+// Every light as a TrafficLight object with its own countdown, against the
+// grid with each kernel and with several workers. All runs start from the same
+// lights, so the checksum over changed indices and final states must agree.
+std::unique_ptr<TrafficLightState> makeLightState(std::uint8_t code) {
+    if (code == kRedLight) return std::make_unique<RedState>();
+    if (code == kGreenLight) return std::make_unique<GreenState>();
+    return std::make_unique<YellowState>();
+}
+
+void runGridBenchmark(std::size_t lights, int ticks) {
+    const LightTimings timings{30, 25, 5};
+    std::cout << "Grid benchmark: " << lights << " lights, " << ticks << " ticks\n";
+
+    auto report = [&](const std::string& name, double seconds, std::uint64_t checksum, std::uint64_t changed) {
+        std::cout << "  " << name << ": " << lights * double(ticks) / seconds / 1e6 << " M light-ticks/s, "
+                  << changed / double(ticks) << " changes/tick, checksum " << checksum << "\n";
+    };
+
+    {
+        TrafficGrid initial(lights, timings, 1);
+        std::vector<TrafficLight> objects(lights);
+        std::vector<std::uint16_t> countdowns(lights);
+        for (std::size_t i = 0; i < lights; ++i) {
+            objects[i].setState(makeLightState(initial.state(i)));
+            countdowns[i] = initial.ticksLeft(i);
+        }
+
+        std::uint64_t checksum = 0;
+        std::uint64_t changed = 0;
+        std::vector<std::uint32_t> changes;
+        auto start = Clock::now();
+        for (int t = 0; t < ticks; ++t) {
+            changes.clear();
+            for (std::size_t i = 0; i < lights; ++i) {
+                if (--countdowns[i] != 0) continue;
+                const char* name = objects[i].stateName();
+                std::uint8_t next = name[0] == 'R' ? kGreenLight : name[0] == 'G' ? kYellowLight : kRedLight;
+                objects[i].setState(makeLightState(next));
+                countdowns[i] = timings.durationOf(next);
+                changes.push_back(static_cast<std::uint32_t>(i));
+            }
+            for (std::uint32_t index : changes) checksum += index;
+            changed += changes.size();
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        for (const TrafficLight& light : objects) checksum += light.stateName()[0];
+        report("objects", seconds, checksum, changed);
+    }
+
+    auto measure = [&](const GridKernels& kernels, std::size_t threads) {
+        TrafficGrid grid(lights, timings, threads, kernels);
+        std::uint64_t checksum = 0;
+        std::uint64_t changed = 0;
+        auto start = Clock::now();
+        for (int t = 0; t < ticks; ++t) {
+            const std::vector<std::uint32_t>& changes = grid.tick();
+            for (std::uint32_t index : changes) checksum += index;
+            changed += changes.size();
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        for (std::size_t i = 0; i < lights; ++i) checksum += grid.stateName(i)[0];
+        report(std::string("grid ") + grid.kernelName() + ", " + std::to_string(grid.threadCount()) + " thread(s)",
+               seconds, checksum, changed);
+    };
+
+    for (const GridKernels* kernels : availableGridKernels()) measure(*kernels, 1);
+    measure(gridKernels(), std::max(2u, std::thread::hardware_concurrency()));
+}
+
+// 10M pending timers with random delays against a binary heap that cancels
+// lazily. Both fire the same timers, so the sums of fired payloads must agree.
+void runTimerBenchmark(std::size_t timers, std::uint64_t horizon) {
+    std::cout << "Timer benchmark: " << timers << " timers over " << horizon << " ticks, every 10th cancelled\n";
+
+    std::mt19937_64 random(7);
+    std::vector<std::uint64_t> delays(timers);
+    for (auto& delay : delays) delay = 1 + random() % horizon;
+
+    auto report = [&](const char* name, double scheduleSeconds, double cancelSeconds, double fireSeconds,
+                      std::size_t fired, std::uint64_t checksum) {
+        std::cout << "  " << name << ": schedule " << scheduleSeconds * 1e9 / timers << " ns, cancel "
+                  << cancelSeconds * 1e9 / (timers / 10) << " ns, fire " << fired / fireSeconds / 1e6
+                  << " M timers/s, checksum " << checksum << "\n";
+    };
+
+    {
+        TimerWheel<std::uint32_t> wheel;
+        wheel.reserve(timers);
+        std::vector<TimerId> ids(timers);
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < timers; ++i) ids[i] = wheel.schedule(delays[i], static_cast<std::uint32_t>(i));
+        double scheduleSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        start = Clock::now();
+        for (std::size_t i = 0; i < timers; i += 10) wheel.cancel(ids[i]);
+        double cancelSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::size_t fired = 0;
+        std::uint64_t checksum = 0;
+        start = Clock::now();
+        wheel.advanceTo(horizon, [&](std::uint64_t tick, const std::vector<std::uint32_t>& due) {
+            fired += due.size();
+            for (std::uint32_t payload : due) checksum += payload ^ tick;
+        });
+        double fireSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+        report("timer wheel", scheduleSeconds, cancelSeconds, fireSeconds, fired, checksum);
+    }
+
+    {
+        using Entry = std::pair<std::uint64_t, std::uint32_t>;
+        std::vector<Entry> storage;
+        storage.reserve(timers);
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap(std::greater<Entry>(), std::move(storage));
+        std::vector<bool> cancelled(timers);
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < timers; ++i) heap.emplace(delays[i], static_cast<std::uint32_t>(i));
+        double scheduleSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        start = Clock::now();
+        for (std::size_t i = 0; i < timers; i += 10) cancelled[i] = true;
+        double cancelSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::size_t fired = 0;
+        std::uint64_t checksum = 0;
+        start = Clock::now();
+        while (!heap.empty()) {
+            auto [tick, payload] = heap.top();
+            heap.pop();
+            if (cancelled[payload]) continue;
+            ++fired;
+            checksum += payload ^ tick;
+        }
+        double fireSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+        report("binary heap", scheduleSeconds, cancelSeconds, fireSeconds, fired, checksum);
+    }
+
+    // Lights reschedule themselves on every switch
+    const std::size_t lights = timers / 10;
+    ScheduledTrafficLights scheduled(lights, LightTimings{30, 25, 5});
+    std::size_t transitions = 0;
+    auto start = Clock::now();
+    scheduled.advanceTo(600, [&](std::uint64_t, std::uint32_t) { ++transitions; });
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "  scheduled lights: " << lights << " lights, " << transitions << " transitions, "
+              << transitions / seconds / 1e6 << " M transitions/s\n";
+}
+
+// Usage: state [--bench [transitions [lights [ticks [timers]]]]]
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        runBenchmark(argc > 2 ? std::atol(argv[2]) : 100000000);
+        runGridBenchmark(argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1 << 22, argc > 4 ? std::atoi(argv[4]) : 200);
+        runTimerBenchmark(argc > 5 ? std::strtoul(argv[5], nullptr, 10) : 10000000, 1 << 20);
+        return 0;
+    }
+
     TrafficLight trafficLight;
 
     trafficLight.change(); // Initial state: Red
@@ -65,5 +852,28 @@ int main() {
     trafficLight.setState(std::make_unique<YellowState>());
     trafficLight.change(); // State changed to Yellow
 
+    // Same sequence, no allocation
+    VariantTrafficLight variantLight;
+    variantLight.change();
+    variantLight.setState<Green>();
+    variantLight.change();
+    variantLight.next();
+    variantLight.change();
+
+    // A small grid: print each light as it switches
+    TrafficGrid grid(8, LightTimings{3, 2, 1});
+    for (int t = 1; t <= 3; ++t) {
+        std::cout << "Tick " << t << ":";
+        for (std::uint32_t light : grid.tick()) std::cout << " light " << light << " -> " << grid.stateName(light) << ";";
+        std::cout << "\n";
+    }
+
+    // Timed lights: light 1 is held red when its first switch comes up
+    ScheduledTrafficLights scheduled(3, LightTimings{3, 2, 1});
+    scheduled.hold(1, 5);
+    scheduled.advanceTo(6, [&](std::uint64_t tick, std::uint32_t light) {
+        std::cout << "At tick " << tick << " light " << light << " is " << scheduled.light(light).stateName() << "\n";
+    });
+
     return 0;
 }
@@ -1,7 +1,21 @@
 // strategy.cpp
 
+/*
+--- Allocation-free states ---
+Animal allocates a new state object on every transition and reaches it
+through a virtual call. VariantAnimal keeps the same routine in a std::variant
+of empty state types, and a compile-time table (NextState) names the
+successor of each state. A transition assigns the next alternative in place,
+and std::visit over three alternatives compiles to a switch, so there is no
+allocation and no indirect call.
+*/
+
 #include <iostream>
+#include <chrono>
+#include <cstdlib>
 #include <memory>
+#include <string>
+#include <variant>
 
 // Forward declaration of state interface
 class AnimalState;
@@ -10,6 +24,7 @@ class AnimalState;
 class Animal {
 private:
     std::unique_ptr<AnimalState> state;
+    std::ostream* output = &std::cout;
 
 public:
     Animal(std::unique_ptr<AnimalState> initialState) 
@@ -18,6 +33,12 @@ public:
     void setState(std::unique_ptr<AnimalState> newState);
 
     void performAction();  // Delegates to state
+
+    // Where states describe what the animal does; nullptr silences them
+    void setOutput(std::ostream* newOutput) { output = newOutput; }
+    void report(const char* message) {
+        if (output) *output << message << std::endl;
+    }
 };
 
 // State Interface
@@ -56,26 +77,102 @@ void Animal::performAction() {
 // State behaviors
 
 void SleepingState::handle(Animal& animal) {
-    std::cout << "Animal is sleeping... zzz" << std::endl;
+    animal.report("Animal is sleeping... zzz");
     // After sleeping, animal wakes and starts eating
     animal.setState(std::make_unique<EatingState>());
 }
 
 void EatingState::handle(Animal& animal) {
-    std::cout << "Animal is eating." << std::endl;
+    animal.report("Animal is eating.");
     // After eating, animal starts walking
     animal.setState(std::make_unique<WalkingState>());
 }
 
 void WalkingState::handle(Animal& animal) {
-    std::cout << "Animal is walking around the farm." << std::endl;
+    animal.report("Animal is walking around the farm.");
     // After walking, animal goes to sleep again
     animal.setState(std::make_unique<SleepingState>());
 }
 
+// Allocation-free states
+struct Sleeping {
+    static constexpr const char* message = "Animal is sleeping... zzz";
+};
+
+struct Eating {
+    static constexpr const char* message = "Animal is eating.";
+};
+
+struct Walking {
+    static constexpr const char* message = "Animal is walking around the farm.";
+};
+
+// Transition table: sleeping -> eating -> walking -> sleeping
+template <typename State>
+struct NextState;
+template <>
+struct NextState<Sleeping> { using type = Eating; };
+template <>
+struct NextState<Eating> { using type = Walking; };
+template <>
+struct NextState<Walking> { using type = Sleeping; };
+
+class VariantAnimal {
+private:
+    std::variant<Sleeping, Eating, Walking> state;
+    std::ostream* output = &std::cout;
+
+public:
+    template <typename State>
+    void setState() {
+        state = State{};
+    }
+
+    void performAction() {
+        std::visit([this](auto current) {
+            using State = decltype(current);
+            if (output) *output << State::message << std::endl;
+            state = typename NextState<State>::type{};
+        }, state);
+    }
+
+    void setOutput(std::ostream* newOutput) { output = newOutput; }
+
+    std::size_t stateIndex() const { return state.index(); }
+};
+
+// Benchmark
+using Clock = std::chrono::steady_clock;
+
+void runBenchmark(long transitions) {
+    std::cout << "Benchmark: " << transitions << " transitions, output off\n";
+
+    Animal animal(std::make_unique<SleepingState>());
+    animal.setOutput(nullptr);
+    auto start = Clock::now();
+    for (long i = 0; i < transitions; ++i) animal.performAction();
+    double classicSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    VariantAnimal variantAnimal;
+    variantAnimal.setOutput(nullptr);
+    start = Clock::now();
+    for (long i = 0; i < transitions; ++i) variantAnimal.performAction();
+    double variantSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::cout << "  unique_ptr states: " << transitions / classicSeconds / 1e6 << " M transitions/s\n"
+              << "  variant states:    " << transitions / variantSeconds / 1e6 << " M transitions/s (ends in state "
+              << variantAnimal.stateIndex() << ")\n";
+}
+
 // Main usage
 
-int main() {
+// Usage: strategy [--bench [transitions]]
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        runBenchmark(argc > 2 ? std::atol(argv[2]) : 100000000);
+        return 0;
+    }
+
     Animal farmAnimal(std::make_unique<SleepingState>());
 
     // Simulate the animal's daily routine:
@@ -83,6 +180,11 @@ int main() {
         farmAnimal.performAction();
     }
 
+    // The same routine without allocating
+    VariantAnimal barnAnimal;
+    for (int i = 0; i < 3; ++i) {
+        barnAnimal.performAction();
+    }
+
     return 0;
 }
-
@@ -1,62 +1,317 @@
 // template.cpp
 
 #include <iostream>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 /*
 --- Problem Statement ---
-We have to design a system for building different types of vehicles. 
+We have to design a system for building different types of vehicles.
+
+--- Assembly line ---
+buildVehicle() runs every step of one vehicle before the next vehicle starts.
+For a batch, AssemblyLine gives each template step its own worker, connected
+by bounded queues: while one vehicle gets its wheels, the next gets its engine
+and a third its body. Both walk the same step table, VehicleTemplate::steps(),
+so every vehicle still goes through the steps in template order. Each stage
+reports its throughput and how much of the run it spent working.
 */
 
 // Step 1: Template Method (Abstract Class)
 class VehicleTemplate {
+private:
+    std::ostream* output = &std::cout;
+
 public:
+    using Step = void (VehicleTemplate::*)();
+
+    struct NamedStep {
+        const char* name;
+        Step step;
+    };
+
+    virtual ~VehicleTemplate() = default;
+
     // Template method defines the algorithm structure
     void buildVehicle() {
-        assembleBody();
-        installEngine();
-        addWheels();
-        std::cout << "Vehicle is ready!\n";
+        for (const NamedStep& step : steps()) (this->*step.step)();
+        finish();
     }
 
     // Abstract methods to be implemented by concrete classes
     virtual void assembleBody() = 0;
     virtual void installEngine() = 0;
     virtual void addWheels() = 0;
+
+    // The steps in build order: assembleBody, installEngine, addWheels
+    static const std::array<NamedStep, 3>& steps() {
+        static const std::array<NamedStep, 3> order{{
+            {"assembleBody", &VehicleTemplate::assembleBody},
+            {"installEngine", &VehicleTemplate::installEngine},
+            {"addWheels", &VehicleTemplate::addWheels},
+        }};
+        return order;
+    }
+
+    void finish() { report("Vehicle is ready!"); }
+
+    // Where steps describe their work; nullptr silences them. Lines from
+    // vehicles on different stages do not interleave mid-line.
+    void setOutput(std::ostream* newOutput) { output = newOutput; }
+    void report(const char* message) {
+        static std::mutex outputMutex;
+        if (!output) return;
+        std::lock_guard<std::mutex> lock(outputMutex);
+        *output << message << '\n';
+    }
 };
 
 // Step 2: Concrete Classes
 class Car : public VehicleTemplate {
 public:
     void assembleBody() override {
-        std::cout << "Assembling car body.\n";
+        report("Assembling car body.");
     }
 
     void installEngine() override {
-        std::cout << "Installing car engine.\n";
+        report("Installing car engine.");
     }
 
     void addWheels() override {
-        std::cout << "Adding 4 wheels to the car.\n";
+        report("Adding 4 wheels to the car.");
     }
 };
 
 class Motorcycle : public VehicleTemplate {
 public:
     void assembleBody() override {
-        std::cout << "Assembling motorcycle frame.\n";
+        report("Assembling motorcycle frame.");
     }
 
     void installEngine() override {
-        std::cout << "Installing motorcycle engine.\n";
+        report("Installing motorcycle engine.");
     }
 
     void addWheels() override {
-        std::cout << "Adding 2 wheels to the motorcycle.\n";
+        report("Adding 2 wheels to the motorcycle.");
+    }
+};
+
+// Bounded queue
+// Blocking FIFO between two stages. push() waits while the queue is full;
+// pop() returns false once the queue is closed and empty.
+template <typename T>
+class BoundedQueue {
+private:
+    std::deque<T> items;
+    std::size_t capacity;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+
+public:
+    explicit BoundedQueue(std::size_t capacity) : capacity(std::max<std::size_t>(capacity, 1)) {}
+
+    void push(T item) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notFull.wait(lock, [this] { return items.size() < capacity; });
+            items.push_back(std::move(item));
+        }
+        notEmpty.notify_one();
+    }
+
+    bool pop(T& item) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+            if (items.empty()) return false;
+            item = std::move(items.front());
+            items.pop_front();
+        }
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        notEmpty.notify_all();
     }
 };
 
+// Assembly line
+// Vehicles are borrowed and must be distinct objects. If a step throws, the
+// line stops working on vehicles but still drains, and build() rethrows the
+// first exception once every stage has finished.
+class AssemblyLine {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct StageReport {
+        const char* step;
+        std::size_t vehicles = 0;
+        double busySeconds = 0;      // inside the step
+        double elapsedSeconds = 0;   // from the start of the build until the stage finished
+
+        double throughput() const { return elapsedSeconds > 0 ? vehicles / elapsedSeconds : 0; }
+        double utilization() const { return elapsedSeconds > 0 ? busySeconds / elapsedSeconds : 0; }
+    };
+
+private:
+    std::size_t queueCapacity;
+
+public:
+    explicit AssemblyLine(std::size_t queueCapacity = 16) : queueCapacity(queueCapacity) {}
+
+    // The last stage also runs finish()
+    std::vector<StageReport> build(const std::vector<VehicleTemplate*>& vehicles) const {
+        const auto& steps = VehicleTemplate::steps();
+        const std::size_t stages = steps.size();
+
+        std::vector<std::unique_ptr<BoundedQueue<VehicleTemplate*>>> queues;   // queues[i] feeds stage i + 1
+        for (std::size_t i = 0; i + 1 < stages; ++i) {
+            queues.push_back(std::make_unique<BoundedQueue<VehicleTemplate*>>(queueCapacity));
+        }
+        std::vector<StageReport> reports(stages);
+        std::vector<std::exception_ptr> errors(stages);
+        std::atomic<bool> failed{false};
+        auto start = Clock::now();
+
+        auto runStage = [&](std::size_t index) {
+            StageReport& report = reports[index];
+            report.step = steps[index].name;
+            std::size_t nextVehicle = 0;
+            auto take = [&](VehicleTemplate*& vehicle) {
+                if (index > 0) return queues[index - 1]->pop(vehicle);
+                if (nextVehicle == vehicles.size()) return false;
+                vehicle = vehicles[nextVehicle++];
+                return true;
+            };
+
+            VehicleTemplate* vehicle;
+            while (take(vehicle)) {
+                if (!failed.load(std::memory_order_relaxed)) {
+                    auto begin = Clock::now();
+                    try {
+                        (vehicle->*steps[index].step)();
+                        if (index + 1 == stages) vehicle->finish();
+                        ++report.vehicles;
+                    } catch (...) {
+                        errors[index] = std::current_exception();
+                        failed = true;
+                    }
+                    report.busySeconds += std::chrono::duration<double>(Clock::now() - begin).count();
+                }
+                if (index + 1 < stages) queues[index]->push(vehicle);
+            }
+            if (index + 1 < stages) queues[index]->close();
+            report.elapsedSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+        };
+
+        std::vector<std::thread> workers;
+        for (std::size_t i = 0; i < stages; ++i) workers.emplace_back(runStage, i);
+        for (auto& worker : workers) worker.join();
+
+        for (const auto& error : errors) {
+            if (error) std::rethrow_exception(error);
+        }
+        return reports;
+    }
+};
+
+void printStageReports(const std::vector<AssemblyLine::StageReport>& reports) {
+    for (const auto& report : reports) {
+        std::cout << "  " << report.step << ": " << report.vehicles << " vehicles, "
+                  << report.throughput() << " vehicles/s, " << report.utilization() * 100 << "% busy\n";
+    }
+}
+
+// Benchmark
+// Steps take a fixed time, as machines on a line do; a worker waiting on a
+// step leaves the CPU to the other stages. Every vehicle records the order it
+// saw its steps in, which must be the template order.
+using Clock = std::chrono::steady_clock;
+
+class TimedVehicle : public VehicleTemplate {
+private:
+    std::chrono::microseconds body, engine, wheels;
+    int order = 0;
+
+    void work(std::chrono::microseconds duration, int step) {
+        if (duration.count() > 0) std::this_thread::sleep_for(duration);
+        order = order * 10 + step;
+    }
+
+public:
+    TimedVehicle(std::chrono::microseconds body, std::chrono::microseconds engine, std::chrono::microseconds wheels)
+        : body(body), engine(engine), wheels(wheels) {
+        setOutput(nullptr);
+    }
+
+    void assembleBody() override { work(body, 1); }
+    void installEngine() override { work(engine, 2); }
+    void addWheels() override { work(wheels, 3); }
+
+    bool builtInOrder() const { return order == 123; }
+};
+
+void runBenchmark(std::size_t count) {
+    auto measure = [count](const char* name, std::chrono::microseconds body, std::chrono::microseconds engine,
+                           std::chrono::microseconds wheels) {
+        std::cout << "Benchmark: " << count << " vehicles, " << name << "\n";
+
+        std::vector<std::unique_ptr<TimedVehicle>> sequential, pipelined;
+        std::vector<VehicleTemplate*> batch;
+        for (std::size_t i = 0; i < count; ++i) {
+            sequential.push_back(std::make_unique<TimedVehicle>(body, engine, wheels));
+            pipelined.push_back(std::make_unique<TimedVehicle>(body, engine, wheels));
+            batch.push_back(pipelined.back().get());
+        }
+
+        auto start = Clock::now();
+        for (auto& vehicle : sequential) vehicle->buildVehicle();
+        double sequentialSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        start = Clock::now();
+        auto reports = AssemblyLine().build(batch);
+        double pipelinedSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::size_t inOrder = 0;
+        for (auto& vehicle : pipelined) inOrder += vehicle->builtInOrder();
+        std::cout << "  one at a time: " << count / sequentialSeconds << " vehicles/s\n"
+                  << "  assembly line: " << count / pipelinedSeconds << " vehicles/s, "
+                  << inOrder << "/" << count << " built in template order\n";
+        printStageReports(reports);
+    };
+
+    using std::chrono::microseconds;
+    measure("empty steps", microseconds(0), microseconds(0), microseconds(0));
+    measure("100/300/200 us steps", microseconds(100), microseconds(300), microseconds(200));
+}
+
 // Step 3: Client Code
-int main() {
+// Usage: template [--bench [vehicles]]
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        runBenchmark(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000);
+        return 0;
+    }
+
     std::cout << "Building a Car:\n";
     Car car;
     car.buildVehicle();
@@ -65,6 +320,12 @@ int main() {
     Motorcycle motorcycle;
     motorcycle.buildVehicle();
 
+    // A batch on the assembly line: vehicles overlap, each keeps its step order
+    std::cout << "\nBuilding a batch on the assembly line:\n";
+    Car first, second;
+    Motorcycle third;
+    auto reports = AssemblyLine().build({&first, &second, &third});
+    printStageReports(reports);
+
     return 0;
 }
-
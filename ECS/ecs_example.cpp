@@ -1 +1,1502 @@
 // ecs_example.cpp
+
+/*
+--- Problem statement ---
+A farm simulation needs to hold millions of animals, hay bales and fences.
+Modelling each one as a heap-allocated object behind a shared_ptr (see
+Structural/composite_animals.cpp) means every update chases a pointer and
+makes a virtual call.
+
+--- Entity-Component-System ---
+Entity:    just an id (index + generation).
+Component: plain data with no behavior (Position, Velocity, Health).
+System:    a loop over every entity that has a given set of components.
+
+--- Archetype storage ---
+Every distinct set of components (an archetype) owns a list of fixed-size
+chunks. Inside a chunk each component is one contiguous column, so a query
+walks dense arrays (structure of arrays) and never follows a pointer per
+entity. Chunks of an archetype are kept full except for the last one.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ECS_X86 1
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+--- Parallel systems ---
+Each system declares which components it reads and which it writes. The
+Scheduler links a system to every earlier system it conflicts with (one
+writes what the other reads or writes) and runs the resulting graph on a
+work-stealing ThreadPool, so independent systems run at the same time. Large
+queries are split further into one task per chunk. Systems may only touch
+component data while a frame runs; creating or destroying entities must
+happen between frames.
+
+--- Snapshots ---
+A snapshot file is the world's own memory written out as raw blocks: the
+entity record table, the free list, and every chunk at its in-memory column
+layout, each chunk starting on a page boundary. Saving writes a new file and
+renames it over the old one, so a world loaded from that file keeps its pages
+and a crash never leaves a half-written snapshot behind. Loading maps the file
+(copy-on-write) and points the chunks straight at it, so there is no
+per-entity decoding; pages are only read when a system first touches them.
+Snapshots are meant to be reloaded on the same kind of machine (same
+endianness and component layout); the header records enough to reject others.
+
+--- Motion kernels ---
+Position and Velocity are pairs of floats, so a chunk's Position column is
+one flat float array (x0, y0, x1, y1, ...). The built-in motion systems run
+integration, damping and bounds clamping straight over those arrays with
+AVX2 or SSE when the CPU has them, and a scalar loop otherwise. The choice is
+made once at startup.
+*/
+
+// Components
+// Every component is plain data and carries a stable name.
+struct Position {
+    static constexpr const char* name = "Position";
+    float x, y;
+};
+
+struct Velocity {
+    static constexpr const char* name = "Velocity";
+    float x, y;
+};
+
+struct Health {
+    static constexpr const char* name = "Health";
+    float hp;
+};
+
+// Entity handle
+struct Entity {
+    std::uint32_t index;
+    std::uint32_t generation;
+
+    bool operator==(const Entity& other) const {
+        return index == other.index && generation == other.generation;
+    }
+};
+
+// Component registry
+// Hands out a small integer id per component type on first use.
+using ComponentId = std::uint32_t;
+constexpr std::size_t kMaxComponents = 64;
+using Signature = std::bitset<kMaxComponents>;
+
+struct ComponentInfo {
+    std::size_t size;
+    std::size_t align;
+    std::string name;
+};
+
+class ComponentRegistry {
+public:
+    template <typename T>
+    static ComponentId id() {
+        static_assert(std::is_trivially_copyable<T>::value, "components must be plain data");
+        static const ComponentId value = add(ComponentInfo{sizeof(T), alignof(T), T::name});
+        return value;
+    }
+
+    static const ComponentInfo& info(ComponentId id) {
+        return infos()[id];
+    }
+
+    static std::size_t count() {
+        return infos().size();
+    }
+
+    // Looks up an already registered component by name, returns false if unknown
+    static bool find(const std::string& name, ComponentId& id) {
+        for (std::size_t i = 0; i < infos().size(); ++i) {
+            if (infos()[i].name == name) {
+                id = static_cast<ComponentId>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    static std::vector<ComponentInfo>& infos() {
+        static std::vector<ComponentInfo> registered;
+        return registered;
+    }
+
+    static ComponentId add(ComponentInfo info) {
+        if (infos().size() == kMaxComponents) {
+            std::cerr << "Too many component types\n";
+            std::abort();
+        }
+        infos().push_back(std::move(info));
+        return static_cast<ComponentId>(infos().size() - 1);
+    }
+};
+
+template <typename... Cs>
+Signature signatureOf() {
+    Signature signature;
+    (signature.set(ComponentRegistry::id<Cs>()), ...);
+    return signature;
+}
+
+// Chunk
+// One block of memory holding `capacity` rows. Column 0 is the Entity of each
+// row, followed by one column per component of the archetype.
+constexpr std::size_t kChunkBytes = 64 * 1024;
+constexpr std::size_t kColumnAlign = 64;
+
+struct AlignedFree {
+    void operator()(std::byte* p) const {
+        ::operator delete[](p, std::align_val_t(kColumnAlign));
+    }
+};
+
+struct Chunk {
+    std::unique_ptr<std::byte[], AlignedFree> memory;   // empty when the columns live in a mapped snapshot
+    std::vector<std::byte*> columns;
+    std::size_t count = 0;
+
+    Entity* entities() const {
+        return reinterpret_cast<Entity*>(columns[0]);
+    }
+};
+
+// Archetype
+class Archetype {
+private:
+    Signature signature;
+    std::vector<ComponentId> components;       // sorted by id
+    std::vector<int> columnIndex;              // component id -> column, -1 if absent
+    std::vector<std::size_t> columnSizes;      // bytes per row, column 0 is the Entity
+    std::vector<std::size_t> columnOffsets;    // byte offset of each column inside a chunk
+    std::size_t capacity = 0;
+    std::size_t chunkSize = 0;                 // bytes of a chunk actually covered by columns
+    std::vector<Chunk> chunks;
+    std::size_t entityCount = 0;
+
+    static std::size_t alignUp(std::size_t n, std::size_t a) {
+        return (n + a - 1) / a * a;
+    }
+
+public:
+    explicit Archetype(Signature sig) : signature(sig), columnIndex(kMaxComponents, -1) {
+        columnSizes.push_back(sizeof(Entity));
+        for (ComponentId id = 0; id < kMaxComponents; ++id) {
+            if (!signature.test(id)) continue;
+            columnIndex[id] = static_cast<int>(columnSizes.size());
+            components.push_back(id);
+            columnSizes.push_back(ComponentRegistry::info(id).size);
+        }
+
+        // Pick the largest row count whose padded columns still fit in a chunk
+        std::size_t rowBytes = 0;
+        for (std::size_t s : columnSizes) rowBytes += s;
+        capacity = kChunkBytes / rowBytes;
+        chunkSize = layout(capacity);
+        while (chunkSize > kChunkBytes) chunkSize = layout(--capacity);
+    }
+
+    // Computes column offsets for `rows` rows and returns the chunk size in bytes
+    std::size_t layout(std::size_t rows) {
+        columnOffsets.clear();
+        std::size_t offset = 0;
+        for (std::size_t s : columnSizes) {
+            columnOffsets.push_back(offset);
+            offset = alignUp(offset + s * rows, kColumnAlign);
+        }
+        return offset;
+    }
+
+    const Signature& getSignature() const { return signature; }
+    const std::vector<ComponentId>& getComponents() const { return components; }
+    std::size_t getCapacity() const { return capacity; }
+    std::size_t getChunkSize() const { return chunkSize; }
+    const std::vector<std::size_t>& getColumnOffsets() const { return columnOffsets; }
+    std::size_t columnCount() const { return columnSizes.size(); }
+    std::size_t size() const { return entityCount; }
+    std::vector<Chunk>& getChunks() { return chunks; }
+
+    int column(ComponentId id) const { return columnIndex[id]; }
+    std::size_t columnSize(int column) const { return columnSizes[column]; }
+
+    template <typename T>
+    T* columnData(const Chunk& chunk) const {
+        return reinterpret_cast<T*>(chunk.columns[columnIndex[ComponentRegistry::id<T>()]]);
+    }
+
+    // Appends a zeroed row for `entity` and returns its (chunk, row) location
+    std::pair<std::uint32_t, std::uint32_t> push(Entity entity) {
+        if (chunks.empty() || chunks.back().count == capacity) {
+            Chunk chunk;
+            chunk.memory.reset(new (std::align_val_t(kColumnAlign)) std::byte[kChunkBytes]);
+            for (std::size_t offset : columnOffsets) {
+                chunk.columns.push_back(chunk.memory.get() + offset);
+            }
+            chunks.push_back(std::move(chunk));
+        }
+        Chunk& chunk = chunks.back();
+        std::size_t row = chunk.count++;
+        chunk.entities()[row] = entity;
+        for (std::size_t c = 1; c < chunk.columns.size(); ++c) {
+            std::memset(chunk.columns[c] + row * columnSizes[c], 0, columnSizes[c]);
+        }
+        ++entityCount;
+        return {static_cast<std::uint32_t>(chunks.size() - 1), static_cast<std::uint32_t>(row)};
+    }
+
+    // Appends a chunk whose columns point into memory the archetype does not own.
+    // As with push(), only the last chunk may be partly filled.
+    void adoptChunk(Chunk chunk) {
+        entityCount += chunk.count;
+        chunks.push_back(std::move(chunk));
+    }
+
+    // Removes a row by moving the archetype's last row into it. Returns the
+    // entity that now lives at (chunkIndex, row), or the removed one if no row moved.
+    Entity swapRemove(std::uint32_t chunkIndex, std::uint32_t row) {
+        Chunk& last = chunks.back();
+        std::size_t lastRow = last.count - 1;
+        Chunk& target = chunks[chunkIndex];
+        Entity moved = last.entities()[lastRow];
+        Entity removed = target.entities()[row];
+
+        if (&target != &last || row != lastRow) {
+            for (std::size_t c = 0; c < target.columns.size(); ++c) {
+                std::memcpy(target.columns[c] + row * columnSizes[c],
+                            last.columns[c] + lastRow * columnSizes[c], columnSizes[c]);
+            }
+        } else {
+            moved = removed;
+        }
+
+        --last.count;
+        --entityCount;
+        if (last.count == 0) chunks.pop_back();
+        return moved;
+    }
+
+    std::byte* componentAt(ComponentId id, std::uint32_t chunkIndex, std::uint32_t row) {
+        int c = columnIndex[id];
+        return chunks[chunkIndex].columns[c] + row * columnSizes[c];
+    }
+};
+
+// Thread pool
+// Every worker owns a deque. It pops its own tasks from the back and steals
+// from the front of the other deques when it runs dry.
+class ThreadPool {
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<std::size_t> pending{0};
+    std::atomic<std::size_t> nextQueue{0};
+    std::atomic<bool> stopping{false};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+
+    inline static thread_local ThreadPool* currentPool = nullptr;
+    inline static thread_local std::size_t currentWorker = 0;
+
+    bool popTask(std::size_t self, std::function<void()>& task) {
+        {
+            WorkerQueue& own = *queues[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (std::size_t i = 1; i < queues.size(); ++i) {
+            WorkerQueue& victim = *queues[(self + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(std::size_t self) {
+        currentPool = this;
+        currentWorker = self;
+        while (true) {
+            if (runOne()) continue;
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this] { return stopping || pending > 0; });
+            if (stopping && pending == 0) return;
+        }
+    }
+
+public:
+    explicit ThreadPool(std::size_t workers = std::thread::hardware_concurrency()) {
+        workers = std::max<std::size_t>(workers, 1);
+        for (std::size_t i = 0; i < workers; ++i) {
+            queues.push_back(std::make_unique<WorkerQueue>());
+        }
+        for (std::size_t i = 0; i < workers; ++i) {
+            threads.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& thread : threads) thread.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t size() const { return threads.size(); }
+
+    // Workers push onto their own deque, other threads spread tasks round robin
+    void submit(std::function<void()> task) {
+        std::size_t target = currentPool == this
+            ? currentWorker
+            : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+        {
+            std::lock_guard<std::mutex> lock(queues[target]->mutex);
+            // Counted before it can be popped, so runOne() never takes pending below zero
+            ++pending;
+            queues[target]->tasks.push_back(std::move(task));
+        }
+        { std::lock_guard<std::mutex> lock(sleepMutex); }
+        wake.notify_one();
+    }
+
+    // Runs one queued task on the calling thread, returns false if none was found
+    bool runOne() {
+        std::size_t self = currentPool == this ? currentWorker : 0;
+        std::function<void()> task;
+        if (!popTask(self, task)) return false;
+        --pending;
+        task();
+        return true;
+    }
+};
+
+// Task group
+// Counts outstanding tasks. wait() helps run queued work instead of blocking,
+// so a task may itself start and wait for a nested group.
+class TaskGroup {
+private:
+    ThreadPool& pool;
+    std::atomic<std::size_t> remaining{0};
+
+public:
+    explicit TaskGroup(ThreadPool& pool) : pool(pool) {}
+    ~TaskGroup() { wait(); }
+
+    void run(std::function<void()> task) {
+        ++remaining;
+        pool.submit([this, task = std::move(task)] {
+            task();
+            --remaining;
+        });
+    }
+
+    void wait() {
+        while (remaining > 0) {
+            if (!pool.runOne()) std::this_thread::yield();
+        }
+    }
+};
+
+// World
+// Owns the archetypes and maps every live entity to its row.
+class World {
+private:
+    friend class Snapshot;
+
+    // Plain data so the whole table can be saved and loaded as one block
+    static constexpr std::uint32_t kNoArchetype = UINT32_MAX;
+    struct Record {
+        std::uint32_t archetype = kNoArchetype;   // index into archetypeList
+        std::uint32_t chunk = 0;
+        std::uint32_t row = 0;
+        std::uint32_t generation = 0;
+    };
+
+    std::vector<Record> records;
+    std::vector<std::uint32_t> freeIndices;
+    std::unordered_map<Signature, std::uint32_t> archetypeIndex;
+    std::vector<std::unique_ptr<Archetype>> archetypeList;
+    std::size_t liveCount = 0;
+
+    // Keeps memory-mapped snapshot files alive while chunks point into them
+    std::vector<std::shared_ptr<void>> mappings;
+
+    std::uint32_t archetypeFor(const Signature& signature) {
+        auto it = archetypeIndex.find(signature);
+        if (it != archetypeIndex.end()) return it->second;
+        std::uint32_t index = static_cast<std::uint32_t>(archetypeList.size());
+        archetypeList.push_back(std::make_unique<Archetype>(signature));
+        archetypeIndex.emplace(signature, index);
+        return index;
+    }
+
+    Archetype& archetypeOf(Entity entity) {
+        return *archetypeList[records[entity.index].archetype];
+    }
+
+    Entity allocateEntity() {
+        std::uint32_t index;
+        if (!freeIndices.empty()) {
+            index = freeIndices.back();
+            freeIndices.pop_back();
+        } else {
+            index = static_cast<std::uint32_t>(records.size());
+            records.emplace_back();
+        }
+        ++liveCount;
+        return Entity{index, records[index].generation};
+    }
+
+    void place(Entity entity, std::uint32_t archetype) {
+        auto location = archetypeList[archetype]->push(entity);
+        Record& record = records[entity.index];
+        record.archetype = archetype;
+        record.chunk = location.first;
+        record.row = location.second;
+    }
+
+    // Removes the row of `entity` from its archetype and fixes up the moved entity
+    void unplace(Entity entity) {
+        Record& record = records[entity.index];
+        Entity moved = archetypeOf(entity).swapRemove(record.chunk, record.row);
+        if (!(moved == entity)) {
+            records[moved.index].chunk = record.chunk;
+            records[moved.index].row = record.row;
+        }
+        record.archetype = kNoArchetype;
+    }
+
+    // Moves an entity to the archetype with `signature`, keeping shared components
+    void migrate(Entity entity, const Signature& signature) {
+        Record& record = records[entity.index];
+        Archetype& from = archetypeOf(entity);
+        std::uint32_t toIndex = archetypeFor(signature);
+        Archetype& to = *archetypeList[toIndex];
+        std::uint32_t oldChunk = record.chunk;
+        std::uint32_t oldRow = record.row;
+
+        auto location = to.push(entity);
+        for (ComponentId id : to.getComponents()) {
+            if (from.column(id) < 0) continue;
+            std::memcpy(to.componentAt(id, location.first, location.second),
+                        from.componentAt(id, oldChunk, oldRow),
+                        ComponentRegistry::info(id).size);
+        }
+
+        unplace(entity);
+        record.archetype = toIndex;
+        record.chunk = location.first;
+        record.row = location.second;
+    }
+
+public:
+    template <typename... Cs>
+    Entity create(const Cs&... components) {
+        std::uint32_t index = archetypeFor(signatureOf<Cs...>());
+        Archetype& archetype = *archetypeList[index];
+        Entity entity = allocateEntity();
+        place(entity, index);
+        Record& record = records[entity.index];
+        ((*reinterpret_cast<Cs*>(archetype.componentAt(ComponentRegistry::id<Cs>(), record.chunk, record.row)) = components), ...);
+        return entity;
+    }
+
+    bool alive(Entity entity) const {
+        return entity.index < records.size()
+            && records[entity.index].archetype != kNoArchetype
+            && records[entity.index].generation == entity.generation;
+    }
+
+    void destroy(Entity entity) {
+        if (!alive(entity)) return;
+        unplace(entity);
+        ++records[entity.index].generation;
+        freeIndices.push_back(entity.index);
+        --liveCount;
+    }
+
+    template <typename T>
+    T* get(Entity entity) {
+        if (!alive(entity)) return nullptr;
+        Record& record = records[entity.index];
+        ComponentId id = ComponentRegistry::id<T>();
+        Archetype& archetype = archetypeOf(entity);
+        if (archetype.column(id) < 0) return nullptr;
+        return reinterpret_cast<T*>(archetype.componentAt(id, record.chunk, record.row));
+    }
+
+    template <typename T>
+    void add(Entity entity, const T& component) {
+        if (!alive(entity)) return;
+        ComponentId id = ComponentRegistry::id<T>();
+        Signature signature = archetypeOf(entity).getSignature();
+        if (!signature.test(id)) migrate(entity, signature.set(id));
+        *get<T>(entity) = component;
+    }
+
+    template <typename T>
+    void remove(Entity entity) {
+        if (!alive(entity)) return;
+        ComponentId id = ComponentRegistry::id<T>();
+        Signature signature = archetypeOf(entity).getSignature();
+        if (signature.test(id)) migrate(entity, signature.reset(id));
+    }
+
+    std::size_t size() const { return liveCount; }
+    std::size_t archetypeCount() const { return archetypeList.size(); }
+
+    // Calls f(count, Cs*...) once per chunk of every archetype that has all of Cs
+    template <typename... Cs, typename F>
+    void eachChunk(F&& f) {
+        Signature required = signatureOf<Cs...>();
+        for (auto& entry : archetypeList) {
+            Archetype& archetype = *entry;
+            if ((archetype.getSignature() & required) != required) continue;
+            for (Chunk& chunk : archetype.getChunks()) {
+                f(chunk.count, archetype.template columnData<Cs>(chunk)...);
+            }
+        }
+    }
+
+    // Calls f(Cs&...) for every entity that has all of Cs
+    template <typename... Cs, typename F>
+    void each(F&& f) {
+        eachChunk<Cs...>([&f](std::size_t count, Cs*... columns) {
+            for (std::size_t i = 0; i < count; ++i) {
+                f(columns[i]...);
+            }
+        });
+    }
+
+    // Like eachChunk, but every chunk becomes its own task on the pool.
+    // f must be safe to call concurrently on different chunks.
+    template <typename... Cs, typename F>
+    void parallelEachChunk(ThreadPool& pool, F&& f) {
+        Signature required = signatureOf<Cs...>();
+        TaskGroup group(pool);
+        for (auto& entry : archetypeList) {
+            Archetype* archetype = entry.get();
+            if ((archetype->getSignature() & required) != required) continue;
+            for (Chunk& chunk : archetype->getChunks()) {
+                Chunk* target = &chunk;
+                group.run([&f, archetype, target] {
+                    f(target->count, archetype->template columnData<Cs>(*target)...);
+                });
+            }
+        }
+        group.wait();
+    }
+
+    template <typename... Cs, typename F>
+    void parallelEach(ThreadPool& pool, F&& f) {
+        parallelEachChunk<Cs...>(pool, [&f](std::size_t count, Cs*... columns) {
+            for (std::size_t i = 0; i < count; ++i) {
+                f(columns[i]...);
+            }
+        });
+    }
+};
+
+// Snapshot
+class Snapshot {
+private:
+    static constexpr char kMagic[8] = {'F', 'A', 'R', 'M', 'E', 'C', 'S', '1'};
+    static constexpr std::uint32_t kVersion = 1;
+    static constexpr std::size_t kBlockAlign = 4096;
+    static constexpr std::uint32_t kEntityColumn = UINT32_MAX;
+
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t chunkBytes;
+        std::uint32_t componentCount;
+        std::uint32_t archetypeCount;
+        std::uint64_t recordCount;
+        std::uint64_t freeCount;
+        std::uint64_t liveCount;
+        std::uint64_t recordsOffset;
+        std::uint64_t freeOffset;
+        std::uint64_t chunkTableOffset;
+    };
+
+    struct ComponentEntry {
+        char name[48];
+        std::uint64_t size;
+    };
+
+    // Column c of the archetype holds file component columnComponent[c]
+    // (kEntityColumn for the entity ids) at columnOffset[c] inside each chunk.
+    struct ArchetypeEntry {
+        std::uint64_t capacity;
+        std::uint64_t chunkCount;
+        std::uint64_t firstChunk;   // index into the chunk table
+        std::uint32_t columnCount;
+        std::uint32_t columnComponent[kMaxComponents + 1];
+        std::uint64_t columnOffset[kMaxComponents + 1];
+    };
+
+    struct ChunkEntry {
+        std::uint64_t offset;
+        std::uint64_t count;
+    };
+
+    static std::uint64_t alignUp(std::uint64_t n, std::uint64_t a) {
+        return (n + a - 1) / a * a;
+    }
+
+    // True if `count` items of `size` bytes starting at `offset` lie inside the file
+    static bool fits(std::uint64_t offset, std::uint64_t count, std::uint64_t size, std::uint64_t fileSize) {
+        return offset <= fileSize && count <= (fileSize - offset) / size;
+    }
+
+    static bool fail(const std::string& path, const std::string& reason) {
+        std::cerr << "Snapshot " << path << ": " << reason << "\n";
+        return false;
+    }
+
+    // fail() for a half-written file, which is removed
+    static bool discard(const std::string& path, const std::string& reason) {
+        std::remove(path.c_str());
+        return fail(path, reason);
+    }
+
+public:
+    static bool save(World& world, const std::string& path) {
+        Header header{};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.chunkBytes = kChunkBytes;
+        header.componentCount = static_cast<std::uint32_t>(ComponentRegistry::count());
+        header.archetypeCount = static_cast<std::uint32_t>(world.archetypeList.size());
+        header.recordCount = world.records.size();
+        header.freeCount = world.freeIndices.size();
+        header.liveCount = world.liveCount;
+
+        std::vector<ComponentEntry> components(header.componentCount);
+        for (std::size_t i = 0; i < components.size(); ++i) {
+            const ComponentInfo& info = ComponentRegistry::info(static_cast<ComponentId>(i));
+            std::strncpy(components[i].name, info.name.c_str(), sizeof(components[i].name) - 1);
+            components[i].size = info.size;
+        }
+
+        std::vector<ArchetypeEntry> archetypes(header.archetypeCount);
+        std::uint64_t totalChunks = 0;
+        for (std::size_t a = 0; a < archetypes.size(); ++a) {
+            Archetype& archetype = *world.archetypeList[a];
+            ArchetypeEntry& entry = archetypes[a];
+            entry = ArchetypeEntry{};
+            entry.capacity = archetype.getCapacity();
+            entry.chunkCount = archetype.getChunks().size();
+            entry.firstChunk = totalChunks;
+            entry.columnCount = static_cast<std::uint32_t>(archetype.columnCount());
+            entry.columnComponent[0] = kEntityColumn;
+            for (std::size_t c = 1; c < archetype.columnCount(); ++c) {
+                entry.columnComponent[c] = archetype.getComponents()[c - 1];
+            }
+            for (std::size_t c = 0; c < archetype.columnCount(); ++c) {
+                entry.columnOffset[c] = archetype.getColumnOffsets()[c];
+            }
+            totalChunks += entry.chunkCount;
+        }
+
+        // Tables first, then the page-aligned chunk blocks
+        std::uint64_t offset = sizeof(Header)
+            + components.size() * sizeof(ComponentEntry)
+            + archetypes.size() * sizeof(ArchetypeEntry);
+        header.recordsOffset = alignUp(offset, 64);
+        header.freeOffset = alignUp(header.recordsOffset + header.recordCount * sizeof(World::Record), 64);
+        header.chunkTableOffset = alignUp(header.freeOffset + header.freeCount * sizeof(std::uint32_t), 64);
+        offset = alignUp(header.chunkTableOffset + totalChunks * sizeof(ChunkEntry), kBlockAlign);
+
+        std::vector<ChunkEntry> chunkTable;
+        chunkTable.reserve(totalChunks);
+        for (auto& archetype : world.archetypeList) {
+            for (Chunk& chunk : archetype->getChunks()) {
+                chunkTable.push_back(ChunkEntry{offset, chunk.count});
+                offset += alignUp(archetype->getChunkSize(), kBlockAlign);
+            }
+        }
+        std::uint64_t fileSize = offset;
+
+        // Written beside the target and renamed over it: a world loaded from
+        // `path` still has the old file mapped, and truncating it in place
+        // would pull the pages out from under its chunks
+        const std::string temporary = path + ".tmp";
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) return fail(temporary, "cannot open for writing");
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(components.data()), components.size() * sizeof(ComponentEntry));
+        out.write(reinterpret_cast<const char*>(archetypes.data()), archetypes.size() * sizeof(ArchetypeEntry));
+        out.seekp(header.recordsOffset);
+        out.write(reinterpret_cast<const char*>(world.records.data()), world.records.size() * sizeof(World::Record));
+        out.seekp(header.freeOffset);
+        out.write(reinterpret_cast<const char*>(world.freeIndices.data()), world.freeIndices.size() * sizeof(std::uint32_t));
+        out.seekp(header.chunkTableOffset);
+        out.write(reinterpret_cast<const char*>(chunkTable.data()), chunkTable.size() * sizeof(ChunkEntry));
+
+        // Only the used rows of each column are written, the gaps stay sparse
+        std::size_t next = 0;
+        for (auto& archetype : world.archetypeList) {
+            for (Chunk& chunk : archetype->getChunks()) {
+                std::uint64_t base = chunkTable[next++].offset;
+                for (std::size_t c = 0; c < archetype->columnCount(); ++c) {
+                    out.seekp(base + archetype->getColumnOffsets()[c]);
+                    out.write(reinterpret_cast<const char*>(chunk.columns[c]), chunk.count * archetype->columnSize(int(c)));
+                }
+            }
+        }
+        out.close();
+        if (!out) return discard(temporary, "write failed");
+
+        int fd = ::open(temporary.c_str(), O_WRONLY);
+        if (fd < 0) return discard(temporary, "cannot reopen");
+        bool synced = ::ftruncate(fd, static_cast<off_t>(fileSize)) == 0 && ::fsync(fd) == 0;
+        ::close(fd);
+        if (!synced) return discard(temporary, "cannot size and sync file");
+        if (::rename(temporary.c_str(), path.c_str()) != 0) return discard(temporary, "cannot replace " + path);
+        return true;
+    }
+
+    // Replaces `world` with the snapshot. Chunks keep pointing into the mapping,
+    // which stays alive for as long as the world does.
+    static bool load(const std::string& path, World& world) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return fail(path, "cannot open");
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+            ::close(fd);
+            return fail(path, "file too small");
+        }
+        std::size_t fileSize = static_cast<std::size_t>(st.st_size);
+        void* address = ::mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (address == MAP_FAILED) return fail(path, "mmap failed");
+        std::shared_ptr<void> mapping(address, [fileSize](void* p) { ::munmap(p, fileSize); });
+        std::byte* base = static_cast<std::byte*>(address);
+
+        // Nothing below trusts a count, offset or index from the file until it
+        // has been checked against the file length and this build's registry
+        const Header& header = *reinterpret_cast<const Header*>(base);
+        if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) return fail(path, "not a snapshot");
+        if (header.version != kVersion || header.chunkBytes != kChunkBytes) return fail(path, "incompatible version");
+        if (header.componentCount > kMaxComponents) return fail(path, "too many components");
+        std::uint64_t tableBytes = std::uint64_t(header.componentCount) * sizeof(ComponentEntry)
+                                 + std::uint64_t(header.archetypeCount) * sizeof(ArchetypeEntry);
+        if (tableBytes > fileSize - sizeof(Header)
+            || !fits(header.recordsOffset, header.recordCount, sizeof(World::Record), fileSize)
+            || !fits(header.freeOffset, header.freeCount, sizeof(std::uint32_t), fileSize)
+            || !fits(header.chunkTableOffset, 0, sizeof(ChunkEntry), fileSize)) {
+            return fail(path, "truncated");
+        }
+        if (header.recordsOffset % alignof(World::Record) != 0 || header.freeOffset % alignof(std::uint32_t) != 0
+            || header.chunkTableOffset % alignof(ChunkEntry) != 0) {
+            return fail(path, "misaligned table");
+        }
+        if (header.recordCount > UINT32_MAX || header.freeCount > header.recordCount
+            || header.liveCount > header.recordCount) {
+            return fail(path, "bad entity counts");
+        }
+
+        auto* components = reinterpret_cast<const ComponentEntry*>(base + sizeof(Header));
+        auto* archetypes = reinterpret_cast<const ArchetypeEntry*>(components + header.componentCount);
+        auto* chunkTable = reinterpret_cast<const ChunkEntry*>(base + header.chunkTableOffset);
+        auto* records = reinterpret_cast<const World::Record*>(base + header.recordsOffset);
+        auto* freeIndices = reinterpret_cast<const std::uint32_t*>(base + header.freeOffset);
+
+        // File component index -> id in this process, matched by name and size
+        std::vector<ComponentId> localIds(header.componentCount);
+        for (std::uint32_t i = 0; i < header.componentCount; ++i) {
+            std::string name(components[i].name, strnlen(components[i].name, sizeof(components[i].name)));
+            if (!ComponentRegistry::find(name, localIds[i])) return fail(path, "unknown component " + name);
+            if (ComponentRegistry::info(localIds[i]).size != components[i].size) return fail(path, "size mismatch for " + name);
+        }
+
+        World loaded;
+        std::uint64_t totalRows = 0;
+        for (std::uint32_t a = 0; a < header.archetypeCount; ++a) {
+            const ArchetypeEntry& entry = archetypes[a];
+            if (entry.columnCount == 0 || entry.columnCount > kMaxComponents + 1
+                || entry.columnComponent[0] != kEntityColumn) {
+                return fail(path, "bad archetype columns");
+            }
+            Signature signature;
+            for (std::uint32_t c = 1; c < entry.columnCount; ++c) {
+                if (entry.columnComponent[c] >= header.componentCount) return fail(path, "bad archetype columns");
+                signature.set(localIds[entry.columnComponent[c]]);
+            }
+            std::uint32_t index = loaded.archetypeFor(signature);
+            if (index != a) return fail(path, "duplicate archetype");
+            Archetype& archetype = *loaded.archetypeList[index];
+            if (archetype.getCapacity() != entry.capacity || archetype.columnCount() != entry.columnCount) {
+                return fail(path, "chunk layout differs from this build");
+            }
+
+            // Each column must lie inside the chunk and be aligned for its type
+            std::vector<int> columns(entry.columnCount);
+            for (std::uint32_t c = 0; c < entry.columnCount; ++c) {
+                columns[c] = c == 0 ? 0 : archetype.column(localIds[entry.columnComponent[c]]);
+                std::size_t align = c == 0 ? alignof(Entity) : ComponentRegistry::info(localIds[entry.columnComponent[c]]).align;
+                std::uint64_t columnBytes = std::uint64_t(archetype.columnSize(columns[c])) * entry.capacity;
+                if (entry.columnOffset[c] > archetype.getChunkSize()
+                    || columnBytes > archetype.getChunkSize() - entry.columnOffset[c]
+                    || entry.columnOffset[c] % align != 0) {
+                    return fail(path, "bad column layout");
+                }
+            }
+
+            if (entry.firstChunk > UINT64_MAX - entry.chunkCount
+                || !fits(header.chunkTableOffset, entry.firstChunk + entry.chunkCount, sizeof(ChunkEntry), fileSize)) {
+                return fail(path, "truncated");
+            }
+            for (std::uint64_t k = 0; k < entry.chunkCount; ++k) {
+                const ChunkEntry& stored = chunkTable[entry.firstChunk + k];
+                if (!fits(stored.offset, archetype.getChunkSize(), 1, fileSize) || stored.offset % kBlockAlign != 0) {
+                    return fail(path, "truncated");
+                }
+                // As in a live archetype, only the last chunk may be partly filled, and none is empty
+                bool last = k + 1 == entry.chunkCount;
+                if (stored.count == 0 || stored.count > entry.capacity || (!last && stored.count != entry.capacity)) {
+                    return fail(path, "bad chunk row count");
+                }
+                Chunk chunk;
+                chunk.count = stored.count;
+                chunk.columns.resize(entry.columnCount);
+                for (std::uint32_t c = 0; c < entry.columnCount; ++c) {
+                    chunk.columns[columns[c]] = base + stored.offset + entry.columnOffset[c];
+                }
+
+                // Every row's entity must be the one whose record points at this row
+                const Entity* entities = chunk.entities();
+                for (std::uint64_t row = 0; row < stored.count; ++row) {
+                    const Entity& entity = entities[row];
+                    if (entity.index >= header.recordCount) return fail(path, "bad entity in chunk");
+                    const World::Record& record = records[entity.index];
+                    if (record.archetype != a || record.chunk != k || record.row != row
+                        || record.generation != entity.generation) {
+                        return fail(path, "entity table does not match chunks");
+                    }
+                }
+                totalRows += stored.count;
+                archetype.adoptChunk(std::move(chunk));
+            }
+        }
+
+        // Rows map one-to-one onto records that name them, so matching counts
+        // leave no live record pointing anywhere else
+        std::uint64_t liveRecords = 0;
+        for (std::uint64_t i = 0; i < header.recordCount; ++i) liveRecords += records[i].archetype != World::kNoArchetype;
+        if (liveRecords != totalRows || liveRecords != header.liveCount) {
+            return fail(path, "entity table does not match chunks");
+        }
+        std::vector<bool> freed(header.recordCount);
+        for (std::uint64_t i = 0; i < header.freeCount; ++i) {
+            std::uint32_t index = freeIndices[i];
+            if (index >= header.recordCount || freed[index] || records[index].archetype != World::kNoArchetype) {
+                return fail(path, "bad free list");
+            }
+            freed[index] = true;
+        }
+
+        loaded.records.assign(records, records + header.recordCount);
+        loaded.freeIndices.assign(freeIndices, freeIndices + header.freeCount);
+        loaded.liveCount = header.liveCount;
+        loaded.mappings.push_back(std::move(mapping));
+
+        world = std::move(loaded);
+        return true;
+    }
+};
+
+// Systems
+void movementSystem(World& world, float dt) {
+    world.each<Position, Velocity>([dt](Position& p, Velocity& v) {
+        p.x += v.x * dt;
+        p.y += v.y * dt;
+    });
+}
+
+void hungerSystem(World& world, float dt) {
+    world.each<Health>([dt](Health& h) {
+        h.hp -= 0.5f * dt;
+    });
+}
+
+// Motion kernels
+// n is the number of floats, i.e. twice the number of entities.
+static_assert(sizeof(Position) == 2 * sizeof(float), "Position must be two packed floats");
+static_assert(sizeof(Velocity) == 2 * sizeof(float), "Velocity must be two packed floats");
+
+struct Bounds {
+    float minX, minY, maxX, maxY;
+};
+
+struct MotionKernels {
+    const char* name;
+    void (*integrate)(float* position, const float* velocity, std::size_t n, float dt);
+    void (*damp)(float* velocity, std::size_t n, float factor);
+    void (*clamp)(float* position, std::size_t n, Bounds bounds);
+};
+
+void integrateScalar(float* position, const float* velocity, std::size_t n, float dt) {
+    for (std::size_t i = 0; i < n; ++i) position[i] += velocity[i] * dt;
+}
+
+void dampScalar(float* velocity, std::size_t n, float factor) {
+    for (std::size_t i = 0; i < n; ++i) velocity[i] *= factor;
+}
+
+void clampScalar(float* position, std::size_t n, Bounds bounds) {
+    for (std::size_t i = 0; i + 1 < n; i += 2) {
+        position[i] = std::min(std::max(position[i], bounds.minX), bounds.maxX);
+        position[i + 1] = std::min(std::max(position[i + 1], bounds.minY), bounds.maxY);
+    }
+}
+
+#ifdef ECS_X86
+// Vector loops handle whole registers, the scalar versions finish the tail.
+// Every register starts on an x float, so (minX, minY, minX, minY, ...) lines up.
+__attribute__((target("sse2")))
+void integrateSse(float* position, const float* velocity, std::size_t n, float dt) {
+    __m128 step = _mm_set1_ps(dt);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 p = _mm_loadu_ps(position + i);
+        __m128 v = _mm_loadu_ps(velocity + i);
+        _mm_storeu_ps(position + i, _mm_add_ps(p, _mm_mul_ps(v, step)));
+    }
+    integrateScalar(position + i, velocity + i, n - i, dt);
+}
+
+__attribute__((target("sse2")))
+void dampSse(float* velocity, std::size_t n, float factor) {
+    __m128 f = _mm_set1_ps(factor);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(velocity + i, _mm_mul_ps(_mm_loadu_ps(velocity + i), f));
+    }
+    dampScalar(velocity + i, n - i, factor);
+}
+
+__attribute__((target("sse2")))
+void clampSse(float* position, std::size_t n, Bounds bounds) {
+    __m128 lo = _mm_setr_ps(bounds.minX, bounds.minY, bounds.minX, bounds.minY);
+    __m128 hi = _mm_setr_ps(bounds.maxX, bounds.maxY, bounds.maxX, bounds.maxY);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 p = _mm_loadu_ps(position + i);
+        _mm_storeu_ps(position + i, _mm_min_ps(_mm_max_ps(p, lo), hi));
+    }
+    clampScalar(position + i, n - i, bounds);
+}
+
+__attribute__((target("avx2")))
+void integrateAvx2(float* position, const float* velocity, std::size_t n, float dt) {
+    __m256 step = _mm256_set1_ps(dt);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 p = _mm256_loadu_ps(position + i);
+        __m256 v = _mm256_loadu_ps(velocity + i);
+        _mm256_storeu_ps(position + i, _mm256_add_ps(p, _mm256_mul_ps(v, step)));
+    }
+    integrateScalar(position + i, velocity + i, n - i, dt);
+}
+
+__attribute__((target("avx2")))
+void dampAvx2(float* velocity, std::size_t n, float factor) {
+    __m256 f = _mm256_set1_ps(factor);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(velocity + i, _mm256_mul_ps(_mm256_loadu_ps(velocity + i), f));
+    }
+    dampScalar(velocity + i, n - i, factor);
+}
+
+__attribute__((target("avx2")))
+void clampAvx2(float* position, std::size_t n, Bounds bounds) {
+    __m256 lo = _mm256_setr_ps(bounds.minX, bounds.minY, bounds.minX, bounds.minY,
+                               bounds.minX, bounds.minY, bounds.minX, bounds.minY);
+    __m256 hi = _mm256_setr_ps(bounds.maxX, bounds.maxY, bounds.maxX, bounds.maxY,
+                               bounds.maxX, bounds.maxY, bounds.maxX, bounds.maxY);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 p = _mm256_loadu_ps(position + i);
+        _mm256_storeu_ps(position + i, _mm256_min_ps(_mm256_max_ps(p, lo), hi));
+    }
+    clampScalar(position + i, n - i, bounds);
+}
+#endif
+
+const MotionKernels kScalarKernels{"scalar", integrateScalar, dampScalar, clampScalar};
+#ifdef ECS_X86
+const MotionKernels kSseKernels{"sse", integrateSse, dampSse, clampSse};
+const MotionKernels kAvx2Kernels{"avx2", integrateAvx2, dampAvx2, clampAvx2};
+#endif
+
+// Every kernel set this CPU can run, best first
+std::vector<const MotionKernels*> availableMotionKernels() {
+    std::vector<const MotionKernels*> kernels;
+#ifdef ECS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) kernels.push_back(&kAvx2Kernels);
+    if (__builtin_cpu_supports("sse2")) kernels.push_back(&kSseKernels);
+#endif
+    kernels.push_back(&kScalarKernels);
+    return kernels;
+}
+
+const MotionKernels& motionKernels() {
+    static const MotionKernels* best = availableMotionKernels().front();
+    return *best;
+}
+
+// Built-in motion systems
+void integrateSystem(World& world, float dt, const MotionKernels& kernels = motionKernels()) {
+    world.eachChunk<Position, Velocity>([dt, &kernels](std::size_t count, Position* p, Velocity* v) {
+        kernels.integrate(&p->x, &v->x, 2 * count, dt);
+    });
+}
+
+void dampingSystem(World& world, float factor, const MotionKernels& kernels = motionKernels()) {
+    world.eachChunk<Velocity>([factor, &kernels](std::size_t count, Velocity* v) {
+        kernels.damp(&v->x, 2 * count, factor);
+    });
+}
+
+void boundsSystem(World& world, Bounds bounds, const MotionKernels& kernels = motionKernels()) {
+    world.eachChunk<Position>([bounds, &kernels](std::size_t count, Position* p) {
+        kernels.clamp(&p->x, 2 * count, bounds);
+    });
+}
+
+// Scheduler
+// A system and the components it declares to read and write.
+struct System {
+    std::string name;
+    Signature reads;
+    Signature writes;
+    std::function<void(World&, ThreadPool&)> run;
+};
+
+class Scheduler {
+private:
+    std::vector<System> systems;
+    std::vector<std::vector<std::size_t>> dependents;   // edges i -> later systems
+    std::vector<std::size_t> dependencyCount;
+
+    static bool conflicts(const System& a, const System& b) {
+        return (a.writes & (b.reads | b.writes)).any() || (b.writes & a.reads).any();
+    }
+
+    struct Frame {
+        World& world;
+        ThreadPool& pool;
+        TaskGroup group;
+        std::unique_ptr<std::atomic<std::size_t>[]> waiting;
+    };
+
+    void launch(std::size_t index, Frame& frame) {
+        frame.group.run([this, index, &frame] {
+            systems[index].run(frame.world, frame.pool);
+            for (std::size_t next : dependents[index]) {
+                if (--frame.waiting[next] == 0) launch(next, frame);
+            }
+        });
+    }
+
+public:
+    // Systems that conflict keep the order in which they were added
+    void addSystem(std::string name, Signature reads, Signature writes,
+                   std::function<void(World&, ThreadPool&)> run) {
+        System system{std::move(name), reads, writes, std::move(run)};
+        std::size_t index = systems.size();
+        dependents.emplace_back();
+        dependencyCount.push_back(0);
+        for (std::size_t earlier = 0; earlier < index; ++earlier) {
+            if (conflicts(systems[earlier], system)) {
+                dependents[earlier].push_back(index);
+                ++dependencyCount[index];
+            }
+        }
+        systems.push_back(std::move(system));
+    }
+
+    void runFrame(World& world, ThreadPool& pool) {
+        Frame frame{world, pool, TaskGroup(pool), std::make_unique<std::atomic<std::size_t>[]>(systems.size())};
+        for (std::size_t i = 0; i < systems.size(); ++i) {
+            frame.waiting[i] = dependencyCount[i];
+        }
+        for (std::size_t i = 0; i < systems.size(); ++i) {
+            if (dependencyCount[i] == 0) launch(i, frame);
+        }
+        frame.group.wait();
+    }
+
+    // Runs systems one at a time in insertion order, without the graph
+    void runSerial(World& world, ThreadPool& pool) {
+        for (System& system : systems) system.run(world, pool);
+    }
+
+    void printGraph() const {
+        for (std::size_t i = 0; i < systems.size(); ++i) {
+            std::cout << "  " << systems[i].name;
+            if (dependencyCount[i] == 0) std::cout << " (no dependencies)";
+            std::cout << "\n";
+            for (std::size_t next : dependents[i]) {
+                std::cout << "    -> " << systems[next].name << "\n";
+            }
+        }
+    }
+};
+
+// The farm's per-frame systems. movement and hunger touch disjoint columns and
+// run side by side; friction waits for movement, census for both.
+Scheduler farmScheduler(float dt, std::atomic<std::size_t>& hungry) {
+    Scheduler scheduler;
+    scheduler.addSystem("movement", signatureOf<Velocity>(), signatureOf<Position>(),
+        [dt](World& world, ThreadPool& pool) {
+            world.parallelEachChunk<Position, Velocity>(pool, [dt](std::size_t count, Position* p, Velocity* v) {
+                motionKernels().integrate(&p->x, &v->x, 2 * count, dt);
+            });
+        });
+    scheduler.addSystem("hunger", Signature(), signatureOf<Health>(),
+        [dt](World& world, ThreadPool& pool) {
+            world.parallelEach<Health>(pool, [dt](Health& h) {
+                h.hp -= 0.5f * dt;
+            });
+        });
+    scheduler.addSystem("friction", Signature(), signatureOf<Velocity>(),
+        [](World& world, ThreadPool& pool) {
+            world.parallelEachChunk<Velocity>(pool, [](std::size_t count, Velocity* v) {
+                motionKernels().damp(&v->x, 2 * count, 0.99f);
+            });
+        });
+    scheduler.addSystem("census", signatureOf<Position, Health>(), Signature(),
+        [&hungry](World& world, ThreadPool& pool) {
+            hungry = 0;
+            world.parallelEachChunk<Health>(pool, [&hungry](std::size_t count, Health* health) {
+                std::size_t local = 0;
+                for (std::size_t i = 0; i < count; ++i) local += health[i].hp < 50.0f;
+                hungry += local;
+            });
+        });
+    return scheduler;
+}
+
+// Object-per-entity baseline, in the style of Structural/composite_animals.cpp
+class FarmObject {
+public:
+    virtual void update(float dt) = 0;
+    virtual ~FarmObject() = default;
+};
+
+class MovingAnimal : public FarmObject {
+public:
+    Position position;
+    Velocity velocity;
+    Health health;
+
+    MovingAnimal(Position p, Velocity v, Health h) : position(p), velocity(v), health(h) {}
+
+    void update(float dt) override {
+        position.x += velocity.x * dt;
+        position.y += velocity.y * dt;
+        health.hp -= 0.5f * dt;
+    }
+};
+
+class HayBale : public FarmObject {
+public:
+    Position position;
+    Health health;
+
+    HayBale(Position p, Health h) : position(p), health(h) {}
+
+    void update(float dt) override {
+        health.hp -= 0.5f * dt;
+    }
+};
+
+// Benchmark
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Every fourth entity is a hay bale (Position + Health, no Velocity)
+Position startPosition(std::size_t i) { return Position{float(i % 1000), float(i / 1000)}; }
+Velocity startVelocity(std::size_t i) { return Velocity{float(i % 7) - 3.0f, float(i % 5) - 2.0f}; }
+
+void runBenchmark(std::size_t entityCount, int frames) {
+    const float dt = 1.0f / 60.0f;
+    std::cout << "Benchmark: " << entityCount << " entities, " << frames << " frames\n";
+
+    double ecsChecksum = 0;
+    {
+        auto start = Clock::now();
+        World world;
+        for (std::size_t i = 0; i < entityCount; ++i) {
+            if (i % 4 == 3) world.create(startPosition(i), Health{100.0f});
+            else world.create(startPosition(i), startVelocity(i), Health{100.0f});
+        }
+        std::cout << "  ECS build:          " << millisecondsSince(start) << " ms\n";
+
+        start = Clock::now();
+        for (int f = 0; f < frames; ++f) {
+            movementSystem(world, dt);
+            hungerSystem(world, dt);
+        }
+        std::cout << "  ECS update/frame:   " << millisecondsSince(start) / frames << " ms\n";
+
+        world.each<Position, Health>([&ecsChecksum](Position& p, Health& h) {
+            ecsChecksum += p.x + p.y + h.hp;
+        });
+
+        ThreadPool pool;
+        std::atomic<std::size_t> hungry{0};
+        Scheduler scheduler = farmScheduler(dt, hungry);
+
+        start = Clock::now();
+        for (int f = 0; f < frames; ++f) scheduler.runSerial(world, pool);
+        std::cout << "  4 systems, one at a time/frame: " << millisecondsSince(start) / frames << " ms\n";
+
+        start = Clock::now();
+        for (int f = 0; f < frames; ++f) scheduler.runFrame(world, pool);
+        std::cout << "  4 systems, scheduled/frame:     " << millisecondsSince(start) / frames
+                  << " ms on " << pool.size() << " workers\n";
+    }
+
+    double objectChecksum = 0;
+    {
+        auto start = Clock::now();
+        std::vector<std::shared_ptr<FarmObject>> objects;
+        objects.reserve(entityCount);
+        for (std::size_t i = 0; i < entityCount; ++i) {
+            if (i % 4 == 3) objects.push_back(std::make_shared<HayBale>(startPosition(i), Health{100.0f}));
+            else objects.push_back(std::make_shared<MovingAnimal>(startPosition(i), startVelocity(i), Health{100.0f}));
+        }
+        std::cout << "  shared_ptr build:   " << millisecondsSince(start) << " ms\n";
+
+        start = Clock::now();
+        for (int f = 0; f < frames; ++f) {
+            for (const auto& object : objects) {
+                object->update(dt);
+            }
+        }
+        std::cout << "  shared_ptr update/frame: " << millisecondsSince(start) / frames << " ms\n";
+
+        for (const auto& object : objects) {
+            if (auto* animal = dynamic_cast<MovingAnimal*>(object.get())) {
+                objectChecksum += animal->position.x + animal->position.y + animal->health.hp;
+            } else {
+                auto* bale = static_cast<HayBale*>(object.get());
+                objectChecksum += bale->position.x + bale->position.y + bale->health.hp;
+            }
+        }
+    }
+
+    std::cout << "  checksums: ECS " << ecsChecksum << ", shared_ptr " << objectChecksum << "\n";
+}
+
+void runDemo() {
+    World world;
+
+    Entity cow = world.create(Position{0, 0}, Velocity{1, 0}, Health{100});
+    Entity sheep = world.create(Position{5, 5}, Velocity{0, -1}, Health{80});
+    Entity hay = world.create(Position{2, 2}, Health{30});
+
+    for (int i = 0; i < 3; ++i) {
+        movementSystem(world, 1.0f);
+        hungerSystem(world, 1.0f);
+    }
+
+    // Keep everyone inside the paddock
+    boundsSystem(world, Bounds{0.0f, 0.0f, 4.0f, 4.0f});
+    std::cout << "Motion kernels: " << motionKernels().name << "\n";
+
+    // The cow stops: it loses its Velocity and moves to another archetype
+    world.remove<Velocity>(cow);
+    movementSystem(world, 1.0f);
+
+    world.destroy(hay);
+
+    for (Entity e : {cow, sheep, hay}) {
+        if (!world.alive(e)) {
+            std::cout << "Entity " << e.index << " destroyed\n";
+            continue;
+        }
+        Position* p = world.get<Position>(e);
+        Health* h = world.get<Health>(e);
+        std::cout << "Entity " << e.index << ": Position = (" << p->x << ", " << p->y
+                  << "), Health = " << h->hp
+                  << (world.get<Velocity>(e) ? ", moving" : ", standing") << "\n";
+    }
+    std::cout << "Archetypes: " << world.archetypeCount() << ", entities: " << world.size() << "\n";
+
+    // Same world, driven by the parallel scheduler
+    ThreadPool pool(4);
+    std::atomic<std::size_t> hungry{0};
+    Scheduler scheduler = farmScheduler(1.0f, hungry);
+    std::cout << "System graph:\n";
+    scheduler.printGraph();
+
+    for (int i = 0; i < 40; ++i) scheduler.runFrame(world, pool);
+    Position* p = world.get<Position>(sheep);
+    std::cout << "Sheep after 40 scheduled frames: Position = (" << p->x << ", " << p->y
+              << "), Health = " << world.get<Health>(sheep)->hp << "\n";
+    std::cout << "Hungry animals: " << hungry << "\n";
+
+    // Checkpoint the farm and bring it back from the mapped file
+    std::string path = "/tmp/ecs_example_snapshot.bin";
+    if (Snapshot::save(world, path)) {
+        World restored;
+        if (Snapshot::load(path, restored)) {
+            Position* q = restored.get<Position>(sheep);
+            std::cout << "Restored sheep: Position = (" << q->x << ", " << q->y
+                      << "), Health = " << restored.get<Health>(sheep)->hp
+                      << ", cow alive: " << std::boolalpha << restored.alive(cow)
+                      << ", hay alive: " << restored.alive(hay) << "\n";
+
+            // Restored worlds keep working: the new entity reuses the hay's slot
+            Entity goat = restored.create(Position{1, 1}, Velocity{1, 1}, Health{60});
+            movementSystem(restored, 1.0f);
+            std::cout << "Goat " << goat.index << " at (" << restored.get<Position>(goat)->x << ", "
+                      << restored.get<Position>(goat)->y << "), entities: " << restored.size() << "\n";
+        }
+        std::remove(path.c_str());
+    }
+}
+
+// Save/load time against entity count, 100k up to `maxEntities`
+void runSnapshotBenchmark(std::size_t maxEntities) {
+    std::string path = "/tmp/ecs_snapshot_bench.bin";
+    std::cout << "Snapshot benchmark (" << path << ")\n";
+
+    for (std::size_t count = 100000; count <= maxEntities; count *= 10) {
+        World world;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (i % 4 == 3) world.create(startPosition(i), Health{100.0f});
+            else world.create(startPosition(i), startVelocity(i), Health{100.0f});
+        }
+        double before = 0;
+        world.each<Position, Health>([&before](Position& p, Health& h) { before += p.x + p.y + h.hp; });
+
+        auto start = Clock::now();
+        if (!Snapshot::save(world, path)) return;
+        double saveMs = millisecondsSince(start);
+
+        World loaded;
+        start = Clock::now();
+        if (!Snapshot::load(path, loaded)) return;
+        double loadMs = millisecondsSince(start);
+
+        // The first pass over the columns pulls the mapped pages in
+        double after = 0;
+        start = Clock::now();
+        loaded.each<Position, Health>([&after](Position& p, Health& h) { after += p.x + p.y + h.hp; });
+        double firstPassMs = millisecondsSince(start);
+
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        std::cout << "  " << count << " entities: save " << saveMs << " ms, load " << loadMs
+                  << " ms, first query " << firstPassMs << " ms, file "
+                  << static_cast<double>(file.tellg()) / (1024 * 1024) << " MiB"
+                  << (before == after ? "" : "  (CHECKSUM MISMATCH)") << "\n";
+    }
+    std::remove(path.c_str());
+}
+
+// One frame of integrate + damp + clamp per kernel set
+void runKernelBenchmark(std::size_t entityCount, int frames) {
+    const float dt = 1.0f / 60.0f;
+    const Bounds field{0.0f, 0.0f, 1000.0f, 10000.0f};
+    std::cout << "Motion kernel benchmark: " << entityCount << " entities, " << frames << " frames\n";
+
+    World world;
+    for (std::size_t i = 0; i < entityCount; ++i) {
+        world.create(startPosition(i), startVelocity(i));
+    }
+
+    for (const MotionKernels* kernels : availableMotionKernels()) {
+        std::size_t i = 0;
+        world.each<Position, Velocity>([&i](Position& p, Velocity& v) {
+            p = startPosition(i);
+            v = startVelocity(i);
+            ++i;
+        });
+
+        auto start = Clock::now();
+        for (int f = 0; f < frames; ++f) {
+            integrateSystem(world, dt, *kernels);
+            dampingSystem(world, 0.99f, *kernels);
+            boundsSystem(world, field, *kernels);
+        }
+        double perFrame = millisecondsSince(start) / frames;
+
+        double checksum = 0;
+        world.each<Position>([&checksum](Position& p) { checksum += p.x + p.y; });
+        std::cout << "  " << kernels->name << ": " << perFrame << " ms/frame, checksum " << checksum << "\n";
+    }
+}
+
+// Usage: ecs_example [--bench [entities] [frames]]
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        std::size_t entities = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10000000;
+        int frames = argc > 3 ? std::atoi(argv[3]) : 10;
+        runBenchmark(entities, frames);
+        runKernelBenchmark(entities, frames);
+        runSnapshotBenchmark(entities);
+        return 0;
+    }
+
+    runDemo();
+    return 0;
+}